@@ -0,0 +1,117 @@
+// Per-command cost of MatchingEngine::process_batch at batch sizes 1, 16 and
+// 256 against one execute() call per command. Both paths collect fills in a
+// reused vector that the consumer drains after every call. The same flow runs
+// on a fresh engine each time and the best of several rounds is kept.
+// Run with: make bench-batch  (or ./bench_batch [--commands N] [--rounds R])
+
+#include "matching_engine.hpp"
+#include "utils/logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+LogLevel Logger::current_level = LogLevel::LOG_OFF;
+
+namespace {
+
+// Limit/market adds around the mid plus cancels and modifies of earlier adds
+std::vector<Command> generate_commands(size_t count) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> price_dist(9950, 10050);
+    std::uniform_int_distribution<> quantity_dist(10, 1000);
+    std::vector<Command> commands;
+    commands.reserve(count);
+    uint64_t next_id = 1;
+    
+    for (uint64_t seq = 1; seq <= count; ++seq) {
+        unsigned roll = gen() % 20;
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        if (roll < 2 && next_id > 1) {
+            commands.push_back(Command::cancel(seq, 1 + gen() % (next_id - 1)));
+        } else if (roll == 2 && next_id > 1) {
+            commands.push_back(Command::modify(seq, 1 + gen() % (next_id - 1), quantity_dist(gen)));
+        } else if (roll == 3) {
+            commands.push_back(Command::add(seq, Order::market_order(next_id++, quantity_dist(gen), side)));
+        } else {
+            commands.push_back(Command::add(seq, Order::limit_order(next_id++, price_dist(gen), quantity_dist(gen), side)));
+        }
+    }
+    return commands;
+}
+
+struct RunResult {
+    double seconds;
+    size_t fills;
+};
+
+// batch == 0 means one execute() call per command
+RunResult run(const std::vector<Command>& commands, size_t batch) {
+    MatchingEngine engine(nullptr, DEFAULT_TICK_SIZE, commands.size());
+    std::vector<Fill> fills;
+    fills.reserve(4096);
+    size_t fill_count = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    if (batch == 0) {
+        for (const Command& command : commands) {
+            engine.execute(command, [&fills](const Fill& fill) { fills.push_back(fill); });
+            fill_count += fills.size();
+            fills.clear();
+        }
+    } else {
+        for (size_t i = 0; i < commands.size(); i += batch) {
+            size_t count = std::min(batch, commands.size() - i);
+            engine.process_batch(commands.data() + i, count, fills);
+            fill_count += fills.size();
+            fills.clear();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {seconds, fill_count};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t command_count = 2000000;
+    int rounds = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--commands" && i + 1 < argc) {
+            command_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--commands N] [--rounds R]" << std::endl;
+            return 1;
+        }
+    }
+    
+    std::vector<Command> commands = generate_commands(command_count);
+    std::printf("%zu commands, best of %d rounds\n", command_count, rounds);
+    std::printf("%-12s %14s %12s %12s %10s\n", "mode", "commands/sec", "ns/command", "fills", "speedup");
+    
+    double baseline = 0.0;
+    for (size_t batch : {size_t(0), size_t(1), size_t(16), size_t(256)}) {
+        RunResult best{1e300, 0};
+        for (int round = 0; round < rounds; ++round) {
+            RunResult result = run(commands, batch);
+            if (result.seconds < best.seconds) {
+                best = result;
+            }
+        }
+        
+        double rate = command_count / best.seconds;
+        if (batch == 0) {
+            baseline = rate;
+        }
+        std::string mode = batch == 0 ? "execute" : "batch/" + std::to_string(batch);
+        std::printf("%-12s %14.0f %12.1f %12zu %9.2fx\n", mode.c_str(), rate, best.seconds * 1e9 / command_count,
+                    best.fills, rate / baseline);
+    }
+    return 0;
+}
@@ -0,0 +1,541 @@
+// Microbenchmarks for the order book and matching engine at several resting
+// depths. Every case builds a fresh book, times one operation at a time and
+// restores the book untimed so the depth stays constant across the run.
+// With --perf, hardware counters are enabled around the same timed regions and
+// reported per operation next to the latencies.
+// Run with: make bench  (or ./bench_runner [--json PATH] [--max-depth N] [--perf])
+
+#include "bench_stats.hpp"
+#include "book_builder.hpp"
+#include "map_order_book.hpp"
+#include "matching_engine.hpp"
+#include "utils/logger.hpp"
+#include "utils/tsc_clock.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+LogLevel Logger::current_level = LogLevel::LOG_ERROR;
+
+namespace {
+
+constexpr Price MID_PRICE = 100000;
+constexpr int ORDER_QUANTITY = 100;
+constexpr int MAX_LEVELS_PER_SIDE = 1000;
+constexpr int SWEEP_LEVELS = 10;
+constexpr size_t BASE_OPS = 100000;
+constexpr uint32_t SEED = 42;
+
+// Resting orders split evenly across both sides, one tick apart from the mid
+struct BookLayout {
+    size_t depth;
+    int levels;         // per side
+    int per_level;      // orders per level
+};
+
+BookLayout layout_for(size_t depth) {
+    int levels = static_cast<int>(std::min<size_t>(depth / 2, MAX_LEVELS_PER_SIDE));
+    levels = std::max(levels, 1);
+    int per_level = static_cast<int>(std::max<size_t>(depth / 2 / levels, 1));
+    return {static_cast<size_t>(levels) * per_level * 2, levels, per_level};
+}
+
+Price level_price(Side side, int level) {
+    return side == Side::BUY ? MID_PRICE - 1 - level : MID_PRICE + 1 + level;
+}
+
+struct RestingOrder {
+    uint64_t order_id;
+    Price price;
+    Side side;
+};
+
+template <typename Book>
+std::unique_ptr<Book> make_book(size_t capacity) {
+    if constexpr (std::is_same<Book, OrderBook>::value) {
+        return std::make_unique<OrderBook>(DEFAULT_TICK_SIZE, 4 * MAX_LEVELS_PER_SIDE, capacity);
+    } else {
+        return std::make_unique<Book>();
+    }
+}
+
+template <typename Book>
+void populate(Book& book, const BookLayout& layout, uint64_t& next_id, std::vector<RestingOrder>* resting) {
+    for (int level = 0; level < layout.levels; ++level) {
+        for (int k = 0; k < layout.per_level; ++k) {
+            for (Side side : {Side::BUY, Side::SELL}) {
+                Price price = level_price(side, level);
+                uint64_t id = next_id++;
+                book.add_order(Order::limit_order(id, price, ORDER_QUANTITY, side));
+                if (resting) {
+                    resting->push_back({id, price, side});
+                }
+            }
+        }
+    }
+}
+
+// Opened by --perf; start/stop are a single branch while it stays closed
+PerfCounters perf_counters;
+
+Side random_side(std::mt19937& gen) {
+    return gen() % 2 ? Side::BUY : Side::SELL;
+}
+
+// Timed region helper: returns elapsed TSC ticks around `op`. The counter
+// syscalls sit outside the clock reads so they never show up in the latency.
+template <typename Op>
+inline uint64_t time_op(Op&& op) {
+    perf_counters.start();
+    uint64_t start = TscClock::now();
+    op();
+    uint64_t elapsed = TscClock::now() - start;
+    perf_counters.stop();
+    return elapsed;
+}
+
+template <typename Book>
+LatencySummary bench_add(const BookLayout& layout, size_t ops) {
+    auto book = make_book<Book>(layout.depth + 16);
+    uint64_t next_id = 1;
+    populate(*book, layout, next_id, nullptr);
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<> level_dist(0, layout.levels - 1);
+    
+    // Passive add at an existing level, cancelled again untimed
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        Side side = random_side(gen);
+        Order order = Order::limit_order(next_id++, level_price(side, level_dist(gen)), ORDER_QUANTITY, side);
+        recorder.record(time_op([&] { book->add_order(order); }));
+        book->cancel_order(order.order_id);
+    }
+    return recorder.summarize();
+}
+
+template <typename Book>
+LatencySummary bench_cancel(const BookLayout& layout, size_t ops) {
+    auto book = make_book<Book>(layout.depth + 16);
+    uint64_t next_id = 1;
+    std::vector<RestingOrder> resting;
+    resting.reserve(layout.depth);
+    populate(*book, layout, next_id, &resting);
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<size_t> pick(0, resting.size() - 1);
+    
+    // Cancel a random resting order, then replace it untimed at the same price
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        RestingOrder& victim = resting[pick(gen)];
+        recorder.record(time_op([&] { book->cancel_order(victim.order_id); }));
+        victim.order_id = next_id++;
+        book->add_order(Order::limit_order(victim.order_id, victim.price, ORDER_QUANTITY, victim.side));
+    }
+    return recorder.summarize();
+}
+
+// In-place quantity reduction; an order whittled down to one lot is put back
+// at full size untimed (cancel and re-add under the same ID)
+template <typename Book>
+LatencySummary bench_reduce(const BookLayout& layout, size_t ops) {
+    auto book = make_book<Book>(layout.depth + 16);
+    uint64_t next_id = 1;
+    std::vector<RestingOrder> resting;
+    resting.reserve(layout.depth);
+    populate(*book, layout, next_id, &resting);
+    std::vector<int> quantities(resting.size(), ORDER_QUANTITY);
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<size_t> pick(0, resting.size() - 1);
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        size_t victim = pick(gen);
+        const RestingOrder& order = resting[victim];
+        int& quantity = quantities[victim];
+        if (quantity == 1) {
+            book->cancel_order(order.order_id);
+            book->add_order(Order::limit_order(order.order_id, order.price, ORDER_QUANTITY, order.side));
+            quantity = ORDER_QUANTITY;
+        }
+        int reduced = quantity - 1;
+        recorder.record(time_op([&] { book->reduce_order(order.order_id, reduced); }));
+        quantity = reduced;
+    }
+    return recorder.summarize();
+}
+
+template <typename Book>
+LatencySummary bench_top_of_book(const BookLayout& layout, size_t ops) {
+    auto book = make_book<Book>(layout.depth + 16);
+    uint64_t next_id = 1;
+    populate(*book, layout, next_id, nullptr);
+    
+    LatencyRecorder recorder(ops);
+    volatile int checksum = 0;
+    for (size_t i = 0; i < ops; ++i) {
+        TopOfBook tob;
+        recorder.record(time_op([&] { tob = book->get_top_of_book(); }));
+        checksum = checksum + tob.bid_quantity.value_or(0);
+    }
+    return recorder.summarize();
+}
+
+// Order ID lookups of resting orders (or of IDs never used, with `miss` set)
+LatencySummary bench_index_lookup(const BookLayout& layout, size_t ops, bool miss) {
+    auto book = make_book<OrderBook>(layout.depth + 16);
+    uint64_t next_id = 1;
+    std::vector<RestingOrder> resting;
+    resting.reserve(layout.depth);
+    populate(*book, layout, next_id, &resting);
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<size_t> pick(0, resting.size() - 1);
+    
+    LatencyRecorder recorder(ops);
+    volatile size_t found = 0;
+    for (size_t i = 0; i < ops; ++i) {
+        uint64_t order_id = miss ? next_id + pick(gen) : resting[pick(gen)].order_id;
+        bool hit = false;
+        recorder.record(time_op([&] { hit = book->has_order(order_id); }));
+        found = found + hit;
+    }
+    return recorder.summarize();
+}
+
+std::unique_ptr<MatchingEngine> make_engine(const BookLayout& layout, uint64_t& next_id) {
+    auto engine = std::make_unique<MatchingEngine>(nullptr, DEFAULT_TICK_SIZE, layout.depth + 16);
+    populate(engine->get_order_book(), layout, next_id, nullptr);
+    return engine;
+}
+
+// Non-crossing limit order through the engine, cancelled again untimed. With
+// `feed` set, the book's level updates drive a BookBuilder inside the timing.
+LatencySummary bench_process_passive(const BookLayout& layout, size_t ops, bool feed = false) {
+    uint64_t next_id = 1;
+    auto engine = std::make_unique<MatchingEngine>(nullptr, DEFAULT_TICK_SIZE, layout.depth + 16);
+    BookBuilder builder;
+    if (feed) {
+        engine->get_order_book().set_level_listener([&builder](const LevelUpdate& update) { builder.apply(update); });
+    }
+    populate(engine->get_order_book(), layout, next_id, nullptr);
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<> level_dist(0, layout.levels - 1);
+    std::vector<Fill> fills;
+    fills.reserve(16);
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        Side side = random_side(gen);
+        Order order = Order::limit_order(next_id++, level_price(side, level_dist(gen)), ORDER_QUANTITY, side);
+        fills.clear();
+        recorder.record(time_op([&] { engine->process_order(order, fills); }));
+        engine->cancel_order(order.order_id);
+    }
+    return recorder.summarize();
+}
+
+// Pulling every level of both sides, the cost a snapshot consumer pays per update
+LatencySummary bench_snapshot(const BookLayout& layout, size_t ops) {
+    uint64_t next_id = 1;
+    auto engine = make_engine(layout, next_id);
+    const OrderBook& book = engine->get_order_book();
+    
+    LatencyRecorder recorder(ops);
+    volatile size_t checksum = 0;
+    for (size_t i = 0; i < ops; ++i) {
+        size_t levels = 0;
+        recorder.record(time_op([&] {
+            levels = book.get_bid_levels(layout.levels).size() + book.get_ask_levels(layout.levels).size();
+        }));
+        checksum = checksum + levels;
+    }
+    return recorder.summarize();
+}
+
+// Aggressive buy that clears the best `levels` ask levels, refilled untimed
+LatencySummary bench_process_sweep(const BookLayout& layout, size_t ops, int levels) {
+    uint64_t next_id = 1;
+    auto engine = make_engine(layout, next_id);
+    levels = std::min(levels, layout.levels);
+    int quantity = levels * layout.per_level * ORDER_QUANTITY;
+    std::vector<Fill> fills;
+    fills.reserve(static_cast<size_t>(levels) * layout.per_level);
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        Order order = Order::limit_order(next_id++, level_price(Side::SELL, levels - 1), quantity, Side::BUY);
+        fills.clear();
+        recorder.record(time_op([&] { engine->process_order(order, fills); }));
+        
+        OrderBook& book = engine->get_order_book();
+        for (int level = 0; level < levels; ++level) {
+            for (int k = 0; k < layout.per_level; ++k) {
+                book.add_order(Order::limit_order(next_id++, level_price(Side::SELL, level), ORDER_QUANTITY, Side::SELL));
+            }
+        }
+    }
+    return recorder.summarize();
+}
+
+// Market order filled by the front order at the best level, replaced untimed
+LatencySummary bench_process_market(const BookLayout& layout, size_t ops) {
+    uint64_t next_id = 1;
+    auto engine = make_engine(layout, next_id);
+    std::mt19937 gen(SEED);
+    std::vector<Fill> fills;
+    fills.reserve(16);
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        Side side = random_side(gen);
+        Side contra = side == Side::BUY ? Side::SELL : Side::BUY;
+        Order order = Order::market_order(next_id++, ORDER_QUANTITY, side);
+        fills.clear();
+        recorder.record(time_op([&] { engine->process_order(order, fills); }));
+        engine->get_order_book().add_order(
+            Order::limit_order(next_id++, level_price(contra, 0), ORDER_QUANTITY, contra));
+    }
+    return recorder.summarize();
+}
+
+// FOK-heavy flow: buys for one level more than the best ten hold are killed by
+// the liquidity check, every tenth asks for the front order only and fills it
+LatencySummary bench_process_fok(const BookLayout& layout, size_t ops) {
+    uint64_t next_id = 1;
+    auto engine = make_engine(layout, next_id);
+    int levels = std::min(SWEEP_LEVELS, layout.levels);
+    int short_quantity = levels * layout.per_level * ORDER_QUANTITY + 1;
+    std::vector<Fill> fills;
+    fills.reserve(16);
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        bool fillable = i % 10 == 0;
+        Order order = Order::limit_order(next_id++, level_price(Side::SELL, levels - 1),
+                                         fillable ? ORDER_QUANTITY : short_quantity, Side::BUY);
+        order.time_in_force = TimeInForce::FOK;
+        fills.clear();
+        recorder.record(time_op([&] { engine->process_order(order, fills); }));
+        if (fillable) {
+            engine->get_order_book().add_order(
+                Order::limit_order(next_id++, level_price(Side::SELL, 0), ORDER_QUANTITY, Side::SELL));
+        }
+    }
+    return recorder.summarize();
+}
+
+// Amend-heavy flow through the engine: 60% reductions kept in place, 20%
+// quantity increases and 20% moves to another level on the same side, both
+// of which cancel/replace. Nothing crosses, so the book keeps its shape.
+LatencySummary bench_process_amend(const BookLayout& layout, size_t ops) {
+    uint64_t next_id = 1;
+    auto engine = std::make_unique<MatchingEngine>(nullptr, DEFAULT_TICK_SIZE, layout.depth + 16);
+    std::vector<RestingOrder> resting;
+    resting.reserve(layout.depth);
+    populate(engine->get_order_book(), layout, next_id, &resting);
+    std::vector<int> quantities(resting.size(), ORDER_QUANTITY);
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<size_t> pick(0, resting.size() - 1);
+    std::uniform_int_distribution<> level_dist(0, layout.levels - 1);
+    std::vector<Fill> fills;
+    fills.reserve(16);
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        size_t victim = pick(gen);
+        RestingOrder& order = resting[victim];
+        int& quantity = quantities[victim];
+        int kind = static_cast<int>(gen() % 10);
+        int new_quantity = quantity;
+        Price new_price = 0;
+        if (kind < 6 && quantity > 1) {
+            new_quantity = quantity - 1;
+        } else if (kind < 8) {
+            new_quantity = quantity < 2 * ORDER_QUANTITY ? quantity + 1 : ORDER_QUANTITY;
+        } else {
+            new_price = level_price(order.side, level_dist(gen));
+        }
+        fills.clear();
+        recorder.record(time_op([&] { engine->modify_order(order.order_id, new_quantity, new_price, fills); }));
+        quantity = new_quantity;
+        if (new_price != 0) {
+            order.price = new_price;
+        }
+    }
+    return recorder.summarize();
+}
+
+// Market order filled by the front contra order with 100k stops pending
+// outside the book. With `fire` set, a stop at the touch the order trades on is
+// queued untimed first, so the timing also covers one activation and its fill.
+// Orders alternate sides so the last trade is always on the far touch and the
+// queued stop cannot fire before the timed order prints.
+LatencySummary bench_process_stops(const BookLayout& layout, size_t ops, bool fire) {
+    constexpr size_t PENDING_STOPS = 100000;
+    uint64_t next_id = 1;
+    auto engine = make_engine(layout, next_id);
+    std::vector<Fill> fills;
+    fills.reserve(16);
+    
+    // Buy stops above the asks and sell stops below the bids never fire here
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<> offset_dist(1, 1000);
+    for (size_t i = 0; i < PENDING_STOPS; ++i) {
+        Side side = random_side(gen);
+        Price trigger = side == Side::BUY ? level_price(Side::SELL, layout.levels) + offset_dist(gen)
+                                          : level_price(Side::BUY, layout.levels) - offset_dist(gen);
+        engine->submit_stop(Order::market_order(next_id++, ORDER_QUANTITY, side), trigger, fills);
+    }
+    
+    OrderBook& book = engine->get_order_book();
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        Side side = i % 2 ? Side::SELL : Side::BUY;
+        Side contra = side == Side::BUY ? Side::SELL : Side::BUY;
+        Price touch = level_price(contra, 0);
+        if (fire) {
+            book.add_order(Order::limit_order(next_id++, touch, ORDER_QUANTITY, contra));
+            engine->submit_stop(Order::market_order(next_id++, ORDER_QUANTITY, side), touch, fills);
+        }
+        Order order = Order::market_order(next_id++, ORDER_QUANTITY, side);
+        fills.clear();
+        recorder.record(time_op([&] { engine->process_order(order, fills); }));
+        for (size_t k = fire ? 1 : 0; k < fills.size(); ++k) {
+            book.add_order(Order::limit_order(next_id++, touch, ORDER_QUANTITY, contra));
+        }
+    }
+    return recorder.summarize();
+}
+
+// Pulls a freshly populated book in bulk: everything, one side, or the ten
+// levels nearest the bid. `one_by_one` times the same full pull done through
+// cancel_order instead, for comparison.
+LatencySummary bench_mass_cancel(const BookLayout& layout, size_t ops, MassCancelScope scope,
+                                 bool one_by_one = false) {
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        uint64_t next_id = 1;
+        auto engine = make_engine(layout, next_id);
+        MassCancel filter = MassCancel::all();
+        if (scope == MassCancelScope::SIDE) {
+            filter = MassCancel::of_side(Side::BUY);
+        } else if (scope == MassCancelScope::PRICE_RANGE) {
+            filter = MassCancel::price_range(Side::BUY, level_price(Side::BUY, SWEEP_LEVELS - 1),
+                                             level_price(Side::BUY, 0));
+        }
+        if (one_by_one) {
+            recorder.record(time_op([&] {
+                for (uint64_t id = 1; id < next_id; ++id) {
+                    engine->cancel_order(id);
+                }
+            }));
+        } else {
+            recorder.record(time_op([&] { engine->mass_cancel(filter); }));
+        }
+    }
+    return recorder.summarize();
+}
+
+// Uncross of an auction book where every order sits in a 2000-tick crossed band
+LatencySummary bench_uncross(const BookLayout& layout, size_t ops) {
+    std::mt19937 gen(SEED);
+    std::uniform_int_distribution<> price_dist(MID_PRICE - 1000, MID_PRICE + 999);
+    uint64_t next_id = 1;
+    
+    LatencyRecorder recorder(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        MatchingEngine engine(nullptr, DEFAULT_TICK_SIZE, layout.depth + 16);
+        engine.begin_auction();
+        for (size_t k = 0; k < layout.depth; ++k) {
+            Side side = k % 2 ? Side::SELL : Side::BUY;
+            engine.process_order(Order::limit_order(next_id++, price_dist(gen), ORDER_QUANTITY, side));
+        }
+        recorder.record(time_op([&] { engine.uncross([](const Fill&) {}); }));
+    }
+    return recorder.summarize();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string json_path = "bench_results.json";
+    size_t max_depth = 1000000;
+    bool with_perf = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            max_depth = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--perf") {
+            with_perf = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--json PATH] [--max-depth N] [--perf]" << std::endl;
+            return 1;
+        }
+    }
+    
+    // Calibrate the TSC before anything is timed
+    TscClock::ns_per_tick();
+    
+    if (with_perf && !perf_counters.open()) {
+        std::cerr << "Hardware counters unavailable (" << perf_counters.error()
+                  << "), reporting latency only" << std::endl;
+    }
+    
+    // Counters only run inside time_op, so the counts since the previous reset
+    // belong to exactly this scenario
+    std::vector<BenchResult> results;
+    auto run = [&](const char* name, const char* book, const BookLayout& layout, LatencySummary summary) {
+        results.push_back({name, book, layout.depth, summary, perf_counters.summarize(summary.samples)});
+        perf_counters.reset();
+        print_bench_result(results.back());
+    };
+    
+    perf_counters.reset();
+    print_bench_header(perf_counters.is_open());
+    for (size_t depth : {size_t(100), size_t(10000), size_t(1000000)}) {
+        if (depth > max_depth) {
+            continue;
+        }
+        BookLayout layout = layout_for(depth);
+        size_t sweep_ops = depth >= 1000000 ? BASE_OPS / 100 : BASE_OPS / 10;
+        
+        run("add_passive", "ladder", layout, bench_add<OrderBook>(layout, BASE_OPS));
+        run("add_passive", "map", layout, bench_add<MapOrderBook>(layout, BASE_OPS));
+        run("cancel", "ladder", layout, bench_cancel<OrderBook>(layout, BASE_OPS));
+        run("cancel", "map", layout, bench_cancel<MapOrderBook>(layout, BASE_OPS));
+        run("reduce", "ladder", layout, bench_reduce<OrderBook>(layout, BASE_OPS));
+        run("reduce", "map", layout, bench_reduce<MapOrderBook>(layout, BASE_OPS));
+        run("top_of_book", "ladder", layout, bench_top_of_book<OrderBook>(layout, BASE_OPS));
+        run("top_of_book", "map", layout, bench_top_of_book<MapOrderBook>(layout, BASE_OPS));
+        run("index_hit", "ladder", layout, bench_index_lookup(layout, BASE_OPS, false));
+        run("index_miss", "ladder", layout, bench_index_lookup(layout, BASE_OPS, true));
+        run("process_passive", "ladder", layout, bench_process_passive(layout, BASE_OPS));
+        run("process_passive", "ladder+feed", layout, bench_process_passive(layout, BASE_OPS, true));
+        run("snapshot_full", "ladder", layout, bench_snapshot(layout, BASE_OPS / 10));
+        run("process_sweep10", "ladder", layout, bench_process_sweep(layout, sweep_ops, SWEEP_LEVELS));
+        run("process_market", "ladder", layout, bench_process_market(layout, BASE_OPS));
+        run("process_fok", "ladder", layout, bench_process_fok(layout, BASE_OPS));
+        run("process_amend", "ladder", layout, bench_process_amend(layout, BASE_OPS));
+        run("market_100k_stops", "ladder", layout, bench_process_stops(layout, BASE_OPS, false));
+        run("stop_trigger_100k", "ladder", layout, bench_process_stops(layout, BASE_OPS, true));
+        run("uncross", "ladder", layout, bench_uncross(layout, depth >= 1000000 ? 5 : 100));
+        size_t pull_ops = depth >= 1000000 ? 5 : 100;
+        run("mass_cancel_all", "ladder", layout, bench_mass_cancel(layout, pull_ops, MassCancelScope::ALL));
+        run("cancel_each_all", "ladder", layout, bench_mass_cancel(layout, pull_ops, MassCancelScope::ALL, true));
+        run("mass_cancel_side", "ladder", layout, bench_mass_cancel(layout, pull_ops, MassCancelScope::SIDE));
+        run("mass_cancel_range10", "ladder", layout,
+            bench_mass_cancel(layout, pull_ops, MassCancelScope::PRICE_RANGE));
+    }
+    
+    if (!write_bench_json(results, json_path)) {
+        std::cerr << "Failed to write " << json_path << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << json_path << std::endl;
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Monte Carlo paths/sec as the worker pool grows. Every thread count runs the
+// same seeded batch, so the work and the results are identical and only the
+// wall time changes.
+// Run with: make bench-montecarlo  (or ./bench_montecarlo [--runs N] [--orders N] [--max-threads K])
+
+#include "monte_carlo.hpp"
+#include "utils/logger.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+LogLevel Logger::current_level = LogLevel::LOG_OFF;
+
+int main(int argc, char* argv[]) {
+    MonteCarloConfig config;
+    config.run_count = 2000;
+    config.orders_per_run = 10000;
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            config.run_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--orders" && i + 1 < argc) {
+            config.orders_per_run = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-threads" && i + 1 < argc) {
+            max_threads = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--runs N] [--orders N] [--max-threads K]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::printf("%zu runs x %zu orders, %u hardware threads\n",
+                config.run_count, config.orders_per_run, std::thread::hardware_concurrency());
+    std::printf("%8s %12s %14s %12s %10s\n", "threads", "runs/sec", "orders/sec", "mean fills", "speedup");
+
+    double baseline = 0.0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        config.thread_count = threads;
+        MonteCarloReport report = MonteCarloRunner(config).run();
+
+        double rate = config.run_count / report.elapsed_seconds;
+        if (threads == 1) {
+            baseline = rate;
+        }
+        std::printf("%8zu %12.1f %14.0f %12.1f %9.2fx\n", threads, rate, rate * config.orders_per_run,
+                    report.fills.mean, rate / baseline);
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+// End-to-end cost of the staged ingestion pipeline against the single-threaded
+// path (parse, sequence, match and publish inline), for each wait strategy.
+// Saturated runs give throughput; one-at-a-time runs give unloaded latency.
+// Run with: make bench-pipeline  (or ./bench_pipeline [--messages N] [--all])
+
+#include "pipeline.hpp"
+#include "utils/logger.hpp"
+#include "utils/tsc_clock.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+LogLevel Logger::current_level = LogLevel::LOG_OFF;
+
+namespace {
+
+constexpr size_t UNLOADED_MESSAGES = 20000;
+
+struct RunResult {
+    double messages_per_sec;
+    uint64_t fills;
+    const LatencyHistogram* latency;
+};
+
+void print_row(const char* mode, const char* load, size_t messages, const RunResult& result) {
+    const LatencyHistogram& l = *result.latency;
+    std::printf("%-16s %-10s %9zu %12.0f %10llu %8llu %8llu %8llu %10llu\n", mode, load, messages,
+                result.messages_per_sec, static_cast<unsigned long long>(result.fills),
+                static_cast<unsigned long long>(l.percentile(0.50)),
+                static_cast<unsigned long long>(l.percentile(0.99)),
+                static_cast<unsigned long long>(l.percentile(0.999)),
+                static_cast<unsigned long long>(l.max()));
+}
+
+// ADD limit/market mix plus cancels of earlier adds. The sequencer numbers
+// adds 1, 2, 3, ..., so the generator knows which ids it can cancel.
+std::vector<std::string> generate_lines(size_t count) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> price_dist(9950, 10050);
+    std::uniform_int_distribution<> quantity_dist(10, 1000);
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    uint64_t adds = 0;
+    char buffer[64];
+    
+    for (size_t i = 0; i < count; ++i) {
+        unsigned roll = gen() % 20;
+        const char* side = gen() % 2 ? "BUY" : "SELL";
+        if (roll == 0 && adds > 0) {
+            std::snprintf(buffer, sizeof(buffer), "CANCEL %llu",
+                          static_cast<unsigned long long>(1 + gen() % adds));
+        } else if (roll <= 2) {
+            std::snprintf(buffer, sizeof(buffer), "ADD %s MARKET 0 %d", side, quantity_dist(gen));
+            adds++;
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "ADD %s LIMIT %.2f %d", side,
+                          price_dist(gen) / 100.0, quantity_dist(gen));
+            adds++;
+        }
+        lines.emplace_back(buffer);
+    }
+    return lines;
+}
+
+// Everything on the caller's thread, timed per message
+RunResult run_single_threaded(const std::vector<std::string>& lines, LatencyHistogram& latency) {
+    MatchingEngine engine(nullptr, DEFAULT_TICK_SIZE, lines.size());
+    uint64_t fills = 0;
+    auto publish_fill = [&fills](const Fill&) { fills++; };
+    uint64_t sequence = 0;
+    uint64_t next_order_id = 1;
+    double ns_per_tick = TscClock::ns_per_tick();
+    
+    auto start_time = std::chrono::steady_clock::now();
+    for (const std::string& line : lines) {
+        uint64_t start = TscClock::now();
+        Command command;
+        if (parse_command(line.data(), line.size(), DEFAULT_TICK_SIZE, command)) {
+            command.sequence = ++sequence;
+            if (command.type == CommandType::ADD) {
+                command.order.order_id = next_order_id++;
+                command.order.timestamp = Order::get_current_timestamp();
+            }
+            engine.execute(command, publish_fill);
+        }
+        latency.record(static_cast<uint64_t>((TscClock::now() - start) * ns_per_tick));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return {lines.size() / seconds, fills, &latency};
+}
+
+RunResult run_pipeline(OrderPipeline& pipeline, const std::vector<std::string>& lines, size_t count,
+                       bool one_at_a_time) {
+    pipeline.start();
+    auto start_time = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        pipeline.submit(lines[i]);
+        if (one_at_a_time) {
+            pipeline.wait_idle();
+        }
+    }
+    pipeline.wait_idle();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    pipeline.stop();
+    return {count / seconds, pipeline.fills(), &pipeline.latency()};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t message_count = 1000000;
+    bool run_all = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--messages" && i + 1 < argc) {
+            message_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--all") {
+            run_all = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--messages N] [--all]" << std::endl;
+            return 1;
+        }
+    }
+    
+    TscClock::ns_per_tick();
+    std::vector<std::string> lines = generate_lines(message_count);
+    size_t unloaded = std::min(message_count, UNLOADED_MESSAGES);
+    unsigned cpus = std::thread::hardware_concurrency();
+    
+    std::printf("%zu messages, %u hardware threads; latency in ns from submit to publish\n", message_count, cpus);
+    std::printf("%-16s %-10s %9s %12s %10s %8s %8s %8s %10s\n",
+                "mode", "load", "messages", "msgs/sec", "fills", "p50", "p99", "p99.9", "max");
+    
+    LatencyHistogram single_latency;
+    print_row("single-thread", "saturated", message_count, run_single_threaded(lines, single_latency));
+    
+    for (WaitStrategy strategy : {WaitStrategy::BUSY_SPIN, WaitStrategy::YIELD, WaitStrategy::BLOCK}) {
+        std::string mode = std::string("pipeline/") + wait_strategy_to_string(strategy);
+        
+        // Four spinning stages plus the producer need their own cores
+        if (strategy == WaitStrategy::BUSY_SPIN && cpus < 5 && !run_all) {
+            std::printf("%-16s skipped: needs 5 hardware threads (use --all to force)\n", mode.c_str());
+            continue;
+        }
+        
+        PipelineConfig config;
+        config.wait_strategy = strategy;
+        config.order_capacity = message_count;
+        {
+            OrderPipeline pipeline(config, [](const Fill&) {});
+            print_row(mode.c_str(), "saturated", message_count, run_pipeline(pipeline, lines, message_count, false));
+        }
+        {
+            OrderPipeline pipeline(config, [](const Fill&) {});
+            print_row(mode.c_str(), "unloaded", unloaded, run_pipeline(pipeline, lines, unloaded, true));
+        }
+    }
+    return 0;
+}
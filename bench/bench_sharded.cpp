@@ -0,0 +1,81 @@
+// Aggregate throughput of the sharded multi-symbol exchange as the number of
+// pinned matching threads grows. The same pre-generated flow is replayed at
+// every shard count; only submit-to-idle is timed.
+// Run with: make bench-sharded  (or ./bench_sharded [--orders N] [--symbols S] [--max-shards K])
+
+#include "sharded_exchange.hpp"
+#include "utils/logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+LogLevel Logger::current_level = LogLevel::LOG_OFF;
+
+int main(int argc, char* argv[]) {
+    size_t order_count = 4000000;
+    size_t symbol_count = 1024;
+    size_t max_shards = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--orders" && i + 1 < argc) {
+            order_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--symbols" && i + 1 < argc) {
+            symbol_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-shards" && i + 1 < argc) {
+            max_shards = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--orders N] [--symbols S] [--max-shards K]" << std::endl;
+            return 1;
+        }
+    }
+    
+    // Same mix as the headless simulator, spread uniformly over the symbols
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> symbol_dist(0, static_cast<int>(symbol_count) - 1);
+    std::uniform_int_distribution<> price_dist(9500, 10500);
+    std::uniform_int_distribution<> quantity_dist(10, 1000);
+    std::vector<Command> commands;
+    commands.reserve(order_count);
+    for (size_t i = 0; i < order_count; ++i) {
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        uint16_t symbol = static_cast<uint16_t>(symbol_dist(gen));
+        Order order = gen() % 10 == 0
+            ? Order::market_order(i + 1, quantity_dist(gen), side, symbol)
+            : Order::limit_order(i + 1, price_dist(gen), quantity_dist(gen), side, symbol);
+        commands.push_back(Command::add(i + 1, order));
+    }
+    
+    std::printf("%zu orders over %zu symbols, %u hardware threads\n",
+                order_count, symbol_count, std::thread::hardware_concurrency());
+    std::printf("%8s %14s %12s %10s\n", "shards", "orders/sec", "fills", "speedup");
+    
+    double baseline = 0.0;
+    for (size_t shards = 1; shards <= max_shards; shards *= 2) {
+        ShardedExchangeConfig config;
+        config.shard_count = shards;
+        config.symbol_count = symbol_count;
+        ShardedExchange exchange(config);
+        exchange.start();
+        
+        auto start = std::chrono::steady_clock::now();
+        for (const Command& command : commands) {
+            exchange.submit(command);
+        }
+        exchange.wait_idle();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        exchange.stop();
+        
+        double rate = order_count / seconds;
+        if (shards == 1) {
+            baseline = rate;
+        }
+        std::printf("%8zu %14.0f %12llu %9.2fx\n", shards, rate,
+                    static_cast<unsigned long long>(exchange.total_fills()), rate / baseline);
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "perf_counters.hpp"
+#include "utils/tsc_clock.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Per-operation latency samples in TSC ticks. Each sample includes one pair of
+// clock reads (a few nanoseconds), which is the same for every benchmark.
+struct LatencySummary {
+    size_t samples = 0;
+    double ops_per_sec = 0.0;   // samples over the summed timed latency
+    double p50_ns = 0.0;
+    double p99_ns = 0.0;
+    double p999_ns = 0.0;
+    double max_ns = 0.0;
+};
+
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(size_t expected_samples) {
+        ticks.reserve(expected_samples);
+    }
+    
+    void record(uint64_t elapsed_ticks) {
+        ticks.push_back(elapsed_ticks);
+    }
+    
+    LatencySummary summarize() {
+        LatencySummary summary;
+        summary.samples = ticks.size();
+        if (ticks.empty()) {
+            return summary;
+        }
+        
+        std::sort(ticks.begin(), ticks.end());
+        double total_ns = 0.0;
+        for (uint64_t t : ticks) {
+            total_ns += TscClock::to_ns(t);
+        }
+        
+        summary.ops_per_sec = total_ns > 0.0 ? ticks.size() * 1e9 / total_ns : 0.0;
+        summary.p50_ns = percentile(0.50);
+        summary.p99_ns = percentile(0.99);
+        summary.p999_ns = percentile(0.999);
+        summary.max_ns = TscClock::to_ns(ticks.back());
+        return summary;
+    }
+
+private:
+    double percentile(double q) const {
+        size_t index = std::min(ticks.size() - 1, static_cast<size_t>(q * ticks.size()));
+        return TscClock::to_ns(ticks[index]);
+    }
+    
+    std::vector<uint64_t> ticks;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string book;
+    size_t depth;       // resting orders when the run started
+    LatencySummary latency;
+    PerfSummary perf;   // hardware counters per op, when --perf could open them
+};
+
+inline void print_bench_header(bool with_perf = false) {
+    std::printf("%-18s %-11s %9s %9s %12s %9s %9s %9s %10s",
+                "benchmark", "book", "depth", "ops", "ops/sec", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    if (with_perf) {
+        std::printf(" %9s %9s %6s %9s %9s %9s %9s",
+                    "cycles", "instr", "IPC", "L1D miss", "LLC miss", "br miss", "dTLB miss");
+    }
+    std::printf("\n");
+}
+
+// Missing counters print as n/a; a trailing * marks multiplexed (scaled) counts
+inline void print_perf_columns(const PerfSummary& perf) {
+    auto column = [](double value, int width) {
+        if (value < 0.0) {
+            std::printf(" %*s", width, "n/a");
+        } else {
+            std::printf(" %*.*f", width, value < 10.0 ? 2 : 0, value);
+        }
+    };
+    for (PerfEvent event : {PerfEvent::CYCLES, PerfEvent::INSTRUCTIONS}) {
+        column(perf.get(event), 9);
+    }
+    double cycles = perf.get(PerfEvent::CYCLES);
+    double instructions = perf.get(PerfEvent::INSTRUCTIONS);
+    column(cycles > 0.0 && instructions >= 0.0 ? instructions / cycles : -1.0, 6);
+    for (PerfEvent event : {PerfEvent::L1D_MISSES, PerfEvent::LLC_MISSES, PerfEvent::BRANCH_MISSES,
+                            PerfEvent::DTLB_MISSES}) {
+        column(perf.get(event), 9);
+    }
+    if (perf.multiplexed) {
+        std::printf(" *");
+    }
+}
+
+inline void print_bench_result(const BenchResult& result) {
+    const LatencySummary& l = result.latency;
+    std::printf("%-18s %-11s %9zu %9zu %12.0f %9.0f %9.0f %9.0f %10.0f",
+                result.name.c_str(), result.book.c_str(), result.depth, l.samples,
+                l.ops_per_sec, l.p50_ns, l.p99_ns, l.p999_ns, l.max_ns);
+    if (result.perf.valid) {
+        print_perf_columns(result.perf);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+// One object per run so results can be diffed between commits
+inline bool write_bench_json(const std::vector<BenchResult>& results, const std::string& path) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        return false;
+    }
+    
+    std::fprintf(out, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        const LatencySummary& l = r.latency;
+        std::fprintf(out,
+                     "    {\"name\": \"%s\", \"book\": \"%s\", \"depth\": %zu, \"ops\": %zu, "
+                     "\"ops_per_sec\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, "
+                     "\"p999_ns\": %.1f, \"max_ns\": %.1f, \"perf\": ",
+                     r.name.c_str(), r.book.c_str(), r.depth, l.samples, l.ops_per_sec,
+                     l.p50_ns, l.p99_ns, l.p999_ns, l.max_ns);
+        
+        // Per-op counts; null for the whole object without --perf and per
+        // event when that counter could not be opened
+        if (!r.perf.valid) {
+            std::fprintf(out, "null");
+        } else {
+            std::fprintf(out, "{\"multiplexed\": %s", r.perf.multiplexed ? "true" : "false");
+            for (size_t e = 0; e < PERF_EVENT_COUNT; ++e) {
+                double value = r.perf.per_op[e];
+                std::fprintf(out, ", \"%s\": ", perf_event_to_string(static_cast<PerfEvent>(e)));
+                if (value < 0.0) {
+                    std::fprintf(out, "null");
+                } else {
+                    std::fprintf(out, "%.3f", value);
+                }
+            }
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+    std::fclose(out);
+    return true;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters read through perf_event_open, user space only. All events
+// share one group so they are enabled, disabled and read together with a
+// single syscall each. An event the CPU or kernel refuses is left out and
+// reported as missing; if cycles cannot be opened (no PMU in a VM or
+// container, perf_event_paranoid too high) nothing is counted at all.
+enum class PerfEvent : uint8_t {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    DTLB_MISSES,
+    COUNT
+};
+
+constexpr size_t PERF_EVENT_COUNT = static_cast<size_t>(PerfEvent::COUNT);
+
+inline const char* perf_event_to_string(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::CYCLES:        return "cycles";
+        case PerfEvent::INSTRUCTIONS:  return "instructions";
+        case PerfEvent::L1D_MISSES:    return "l1d_misses";
+        case PerfEvent::LLC_MISSES:    return "llc_misses";
+        case PerfEvent::BRANCH_MISSES: return "branch_misses";
+        case PerfEvent::DTLB_MISSES:   return "dtlb_misses";
+        case PerfEvent::COUNT:         break;
+    }
+    return "unknown";
+}
+
+// Per-operation averages; an entry is negative when its event was unavailable
+struct PerfSummary {
+    bool valid = false;
+    bool multiplexed = false;   // counts were scaled up from part of the run
+    std::array<double, PERF_EVENT_COUNT> per_op{};
+    
+    double get(PerfEvent event) const {
+        return per_op[static_cast<size_t>(event)];
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds.fill(-1);
+    }
+    
+    ~PerfCounters() {
+        close();
+    }
+    
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    
+    // Returns false with a reason in error() when the group cannot be opened
+    bool open() {
+        close();
+#ifdef __linux__
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                               PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            describe(static_cast<PerfEvent>(i), attr);
+            
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (leader < 0) {
+                    reason = std::string("cycles: ") + std::strerror(errno);
+                    return false;
+                }
+                continue;
+            }
+            if (ioctl(fd, PERF_EVENT_IOC_ID, &ids[i]) != 0) {
+                ::close(fd);
+                continue;
+            }
+            fds[i] = fd;
+            if (leader < 0) {
+                leader = fd;
+            }
+        }
+        return true;
+#else
+        reason = "perf_event_open is Linux only";
+        return false;
+#endif
+    }
+    
+    void close() {
+#ifdef __linux__
+        for (int& fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+#endif
+        leader = -1;
+    }
+    
+    bool is_open() const { return leader >= 0; }
+    bool has(PerfEvent event) const { return fds[static_cast<size_t>(event)] >= 0; }
+    const std::string& error() const { return reason; }
+    
+    // Zeroes the group; called before each scenario
+    void reset() {
+#ifdef __linux__
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+    
+    // Brackets one timed operation, outside its clock reads
+    void start() {
+#ifdef __linux__
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+    
+    void stop() {
+#ifdef __linux__
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+    
+    // Totals since reset() divided by `ops`
+    PerfSummary summarize(size_t ops) const {
+        PerfSummary summary;
+        summary.per_op.fill(-1.0);
+#ifdef __linux__
+        if (leader < 0 || ops == 0) {
+            return summary;
+        }
+        
+        // {nr, time_enabled, time_running, {value, id} * nr}
+        uint64_t buffer[3 + 2 * PERF_EVENT_COUNT];
+        ssize_t bytes = ::read(leader, buffer, sizeof(buffer));
+        if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            return summary;
+        }
+        uint64_t nr = buffer[0];
+        uint64_t enabled = buffer[1];
+        uint64_t running = buffer[2];
+        if (running == 0) {
+            return summary;
+        }
+        double scale = static_cast<double>(enabled) / static_cast<double>(running);
+        summary.multiplexed = running < enabled;
+        
+        for (uint64_t k = 0; k < nr && k < PERF_EVENT_COUNT; ++k) {
+            uint64_t value = buffer[3 + 2 * k];
+            uint64_t id = buffer[4 + 2 * k];
+            for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+                if (fds[i] >= 0 && ids[i] == id) {
+                    summary.per_op[i] = value * scale / static_cast<double>(ops);
+                }
+            }
+        }
+        summary.valid = true;
+#else
+        (void)ops;
+#endif
+        return summary;
+    }
+
+private:
+#ifdef __linux__
+    static uint64_t cache_config(uint64_t cache, uint64_t op, uint64_t result) {
+        return cache | (op << 8) | (result << 16);
+    }
+    
+    static void describe(PerfEvent event, perf_event_attr& attr) {
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (event) {
+            case PerfEvent::CYCLES:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case PerfEvent::INSTRUCTIONS:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case PerfEvent::L1D_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                           PERF_COUNT_HW_CACHE_RESULT_MISS);
+                break;
+            case PerfEvent::LLC_MISSES:
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+            case PerfEvent::BRANCH_MISSES:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case PerfEvent::DTLB_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = cache_config(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                           PERF_COUNT_HW_CACHE_RESULT_MISS);
+                break;
+            case PerfEvent::COUNT:
+                break;
+        }
+    }
+#endif
+
+    std::array<int, PERF_EVENT_COUNT> fds;
+    std::array<uint64_t, PERF_EVENT_COUNT> ids{};
+    int leader = -1;
+    std::string reason;
+};
@@ -1,5 +1,7 @@
 #include "src/exchange_simulator.hpp"
+#include "src/monte_carlo.hpp"
 #include "src/utils/logger.hpp"
+#include "src/utils/async_logger.hpp"
 #include <iostream>
 #include <string>
 
@@ -9,11 +11,28 @@ LogLevel Logger::current_level = LogLevel::LOG_INFO;
 void print_usage() {
     std::cout << "\nLimit Order Book Simulator\n";
     std::cout << "==========================\n";
-    std::cout << "Usage: ./lob_simulator [mode]\n\n";
+    std::cout << "Usage: ./lob_simulator [mode] [--async-log] [--orders N] [--seed S] [--runs N] [--threads T] [--record FILE]\n\n";
     std::cout << "Modes:\n";
     std::cout << "  interactive  - Interactive command line mode (default)\n";
     std::cout << "  simulation   - Run automated simulation\n";
+    std::cout << "  headless     - Replay N generated orders at full speed and report throughput\n";
+    std::cout << "  replay FILE  - Replay a recorded flow file at full speed\n";
+    std::cout << "  montecarlo   - Run many independent seeded paths on all cores and report distributions\n";
     std::cout << "  help         - Show this help message\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --async-log  - Format and write log lines on a background thread\n";
+    std::cout << "  --orders N   - Orders to generate in headless mode (default 1000000), per run in montecarlo (default 10000)\n";
+    std::cout << "  --seed S     - Random seed for headless mode, base seed for montecarlo (default 42)\n";
+    std::cout << "  --runs N     - Paths in montecarlo mode (default 1000)\n";
+    std::cout << "  --threads T  - Worker threads in montecarlo mode (default one per hardware thread)\n";
+    std::cout << "  --path SEED  - Montecarlo: rerun the single path with this seed as printed in the report\n";
+    std::cout << "  --market-ratio R - Montecarlo share of market orders (default 0.1)\n";
+    std::cout << "  --cancel-ratio R - Montecarlo share of events that cancel an earlier order (default 0)\n";
+    std::cout << "  --record F   - Write every submitted order, cancel and modify to flow file F\n";
+    std::cout << "  --journal F  - Interactive/simulation: recover the book from F (and --snapshot) on start,\n";
+    std::cout << "                 then journal every command to F before applying it\n";
+    std::cout << "  --snapshot F - Snapshot file used with --journal\n";
+    std::cout << "  --snapshot-every N - Commands between snapshots, after which the journal is truncated (default 100000)\n\n";
     std::cout << "Interactive Commands:\n";
     std::cout << "  ADD <SIDE> <TYPE> <PRICE> <QUANTITY>\n";
     std::cout << "    Example: ADD BUY LIMIT 100.50 200\n";
@@ -30,8 +49,53 @@ int main(int argc, char* argv[]) {
     Logger::current_level = LogLevel::LOG_INFO;
     
     std::string mode = "interactive";
-    if (argc > 1) {
-        mode = argv[1];
+    std::string replay_path;
+    std::string record_path;
+    std::string journal_path;
+    std::string snapshot_path;
+    uint64_t snapshot_interval = 100000;
+    bool mode_given = false;
+    bool async_log = false;
+    size_t order_count = 1000000;
+    bool orders_given = false;
+    uint32_t seed = 42;
+    MonteCarloConfig monte_carlo;
+    bool single_path = false;
+    uint64_t path_seed = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--async-log") {
+            async_log = true;
+        } else if (arg == "--orders" && i + 1 < argc) {
+            order_count = std::stoull(argv[++i]);
+            orders_given = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--runs" && i + 1 < argc) {
+            monte_carlo.run_count = std::stoull(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            monte_carlo.thread_count = std::stoull(argv[++i]);
+        } else if (arg == "--path" && i + 1 < argc) {
+            path_seed = std::stoull(argv[++i]);
+            single_path = true;
+        } else if (arg == "--market-ratio" && i + 1 < argc) {
+            monte_carlo.flow.market_ratio = std::stod(argv[++i]);
+        } else if (arg == "--cancel-ratio" && i + 1 < argc) {
+            monte_carlo.flow.cancel_ratio = std::stod(argv[++i]);
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (arg == "--snapshot-every" && i + 1 < argc) {
+            snapshot_interval = std::stoull(argv[++i]);
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (!mode_given) {
+            mode = arg;
+            mode_given = true;
+        } else {
+            replay_path = arg;
+        }
     }
     
     if (mode == "help" || mode == "--help" || mode == "-h") {
@@ -39,25 +103,88 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
+    if (async_log) {
+        AsyncLogger::start();
+    }
+    
+    int status = 0;
     try {
         ExchangeSimulator simulator;
+        FlowRecorder recorder;
+        if (!record_path.empty()) {
+            if (!recorder.open(record_path, simulator.get_engine().get_order_book().tick_size())) {
+                AsyncLogger::stop();
+                return 1;
+            }
+            simulator.set_recorder(&recorder);
+        }
+        
+        if (!journal_path.empty()) {
+            // Other modes run their own engines, which the journal would not describe
+            if (mode != "interactive" && mode != "simulation") {
+                std::cerr << "--journal only applies to interactive and simulation modes" << std::endl;
+                AsyncLogger::stop();
+                return 1;
+            }
+            RecoveryStats stats;
+            if (!simulator.open_journal(journal_path, snapshot_path, snapshot_interval, stats)) {
+                std::cerr << "Cannot recover from " << journal_path << std::endl;
+                AsyncLogger::stop();
+                return 1;
+            }
+            std::cout << "Recovered " << stats.snapshot_orders << " snapshot orders and " << stats.replayed
+                      << " journal commands up to sequence " << stats.last_sequence << std::endl;
+        }
         
         if (mode == "simulation") {
             std::cout << "Starting automated simulation...\n" << std::endl;
             simulator.run_simulation(10, 3); // 10 seconds, 3 orders per second
+        } else if (mode == "headless" || mode == "bench") {
+            HeadlessReport report = simulator.run_headless(order_count, seed);
+            ExchangeSimulator::print_headless_report(report);
+        } else if (mode == "montecarlo") {
+            monte_carlo.base_seed = seed;
+            if (orders_given) {
+                monte_carlo.orders_per_run = order_count;
+            }
+            if (single_path) {
+                PathResult path = MonteCarloRunner::run_path(path_seed, monte_carlo.flow, monte_carlo.orders_per_run);
+                MonteCarloRunner::print_path(path, monte_carlo.flow.tick_size);
+            } else {
+                MonteCarloReport report = MonteCarloRunner(monte_carlo).run();
+                MonteCarloRunner::print_report(report, monte_carlo.flow.tick_size);
+            }
+        } else if (mode == "replay") {
+            HeadlessReport report;
+            if (simulator.run_replay(replay_path, report)) {
+                ExchangeSimulator::print_headless_report(report);
+            } else {
+                status = 1;
+            }
         } else if (mode == "interactive") {
             print_usage();
             simulator.run_interactive_mode();
         } else {
             std::cerr << "Unknown mode: " << mode << std::endl;
             print_usage();
-            return 1;
+            status = 1;
         }
         
+        if (recorder.is_open()) {
+            uint64_t recorded = recorder.recorded();
+            if (recorder.close()) {
+                std::cout << "Recorded " << recorded << " commands to " << record_path << std::endl;
+            } else {
+                status = 1;
+            }
+        }
+    
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        status = 1;
     }
     
-    return 0;
+    // Drain anything still queued before exiting
+    AsyncLogger::stop();
+    return status;
 }
@@ -0,0 +1,68 @@
+#include "book_builder.hpp"
+#include "utils/logger.hpp"
+
+bool BookBuilder::apply(const LevelUpdate& update) {
+    bool in_sequence = update.sequence == sequence + 1;
+    if (!in_sequence) {
+        LOG_ERROR("Level update gap: expected sequence {}, got {}", sequence + 1, update.sequence);
+        gaps++;
+    }
+    sequence = update.sequence;
+    
+    if (update.side == Side::BUY) {
+        if (update.total_quantity > 0) {
+            bids[update.price] = {update.total_quantity, update.order_count};
+        } else {
+            bids.erase(update.price);
+        }
+    } else {
+        if (update.total_quantity > 0) {
+            asks[update.price] = {update.total_quantity, update.order_count};
+        } else {
+            asks.erase(update.price);
+        }
+    }
+    return in_sequence;
+}
+
+void BookBuilder::reset(uint64_t last_sequence) {
+    bids.clear();
+    asks.clear();
+    sequence = last_sequence;
+}
+
+TopOfBook BookBuilder::get_top_of_book() const {
+    TopOfBook tob;
+    
+    if (!bids.empty()) {
+        tob.best_bid = ticks_to_price(bids.begin()->first, tick);
+        tob.bid_quantity = bids.begin()->second.total_quantity;
+    }
+    
+    if (!asks.empty()) {
+        tob.best_ask = ticks_to_price(asks.begin()->first, tick);
+        tob.ask_quantity = asks.begin()->second.total_quantity;
+    }
+    
+    return tob;
+}
+
+std::vector<PriceLevel> BookBuilder::get_bid_levels(int depth) const {
+    return collect_levels(bids, depth);
+}
+
+std::vector<PriceLevel> BookBuilder::get_ask_levels(int depth) const {
+    return collect_levels(asks, depth);
+}
+
+template <typename Levels>
+std::vector<PriceLevel> BookBuilder::collect_levels(const Levels& levels, int depth) const {
+    std::vector<PriceLevel> result;
+    for (const auto& [price, state] : levels) {
+        if (static_cast<int>(result.size()) >= depth) {
+            break;
+        }
+        result.push_back({ticks_to_price(price, tick), state.total_quantity, state.order_count});
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "market_data.hpp"
+#include "order_book.hpp"
+#include <map>
+#include <vector>
+
+// Consumer-side depth rebuilt from a LevelUpdate stream. Each update costs one
+// map operation, whatever the depth of the book that produced it.
+class BookBuilder {
+public:
+    explicit BookBuilder(double tick_size = DEFAULT_TICK_SIZE) : tick(tick_size) {}
+    
+    // Applies the update; false if it does not follow the last sequence number
+    bool apply(const LevelUpdate& update);
+    
+    // Forget all levels and expect the update after `last_sequence` next
+    void reset(uint64_t last_sequence = 0);
+    
+    // Book information, same shape as OrderBook
+    TopOfBook get_top_of_book() const;
+    std::vector<PriceLevel> get_bid_levels(int depth = 5) const;
+    std::vector<PriceLevel> get_ask_levels(int depth = 5) const;
+    
+    size_t level_count(bool buy_side) const { return buy_side ? bids.size() : asks.size(); }
+    uint64_t last_sequence() const { return sequence; }
+    uint64_t gap_count() const { return gaps; }
+
+private:
+    struct LevelState {
+        int total_quantity;
+        int order_count;
+    };
+    
+    template <typename Levels>
+    std::vector<PriceLevel> collect_levels(const Levels& levels, int depth) const;
+    
+    double tick;
+    std::map<Price, LevelState, std::greater<Price>> bids;
+    std::map<Price, LevelState> asks;
+    uint64_t sequence = 0;
+    uint64_t gaps = 0;
+};
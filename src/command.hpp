@@ -0,0 +1,126 @@
+#pragma once
+
+#include "mass_cancel.hpp"
+#include "order.hpp"
+#include <cstdint>
+#include <type_traits>
+
+enum class CommandType : uint8_t {
+    ADD,        // new limit or market order
+    CANCEL,
+    MODIFY,
+    ADD_STOP,   // order held until a trade reaches trigger_price
+    MASS_CANCEL,
+    BEGIN_AUCTION,
+    UNCROSS     // ends the auction; order.price is the reference price, 0 for none
+};
+
+// Symbol id of a MASS_CANCEL that applies to every symbol's book at once
+constexpr uint16_t ALL_SYMBOLS = UINT16_MAX;
+
+// One order-flow event. ADD carries the full order and ADD_STOP adds its trigger;
+// CANCEL and MODIFY only use order.order_id, order.symbol_id, order.timestamp and
+// (for MODIFY) order.quantity and order.price, where a price of 0 leaves the price
+// unchanged.
+// MASS_CANCEL keeps its filter in scope, order.side, order.owner_id and the
+// price range [order.price, trigger_price]. BEGIN_AUCTION and UNCROSS carry
+// no order, only UNCROSS's reference price. The layout is also the on-disk
+// record of a flow file, so it must stay fixed-width.
+struct Command {
+    uint64_t sequence;
+    CommandType type;
+    MassCancelScope scope;  // MASS_CANCEL only
+    Price trigger_price;    // ADD_STOP, or the top of a MASS_CANCEL range; sits in what would be padding
+    Order order;
+    
+    static Command add(uint64_t sequence, const Order& order) {
+        Command command{};
+        command.sequence = sequence;
+        command.type = CommandType::ADD;
+        command.order = order;
+        return command;
+    }
+    
+    static Command add_stop(uint64_t sequence, const Order& order, Price trigger_price) {
+        Command command = add(sequence, order);
+        command.type = CommandType::ADD_STOP;
+        command.trigger_price = trigger_price;
+        return command;
+    }
+    
+    static Command cancel(uint64_t sequence, uint64_t order_id, uint64_t timestamp = 0, uint16_t symbol_id = 0) {
+        Command command{};
+        command.sequence = sequence;
+        command.type = CommandType::CANCEL;
+        command.order.order_id = order_id;
+        command.order.timestamp = timestamp;
+        command.order.symbol_id = symbol_id;
+        return command;
+    }
+    
+    static Command modify(uint64_t sequence, uint64_t order_id, int quantity, uint64_t timestamp = 0,
+                          uint16_t symbol_id = 0) {
+        Command command{};
+        command.sequence = sequence;
+        command.type = CommandType::MODIFY;
+        command.order.order_id = order_id;
+        command.order.quantity = quantity;
+        command.order.timestamp = timestamp;
+        command.order.symbol_id = symbol_id;
+        return command;
+    }
+    
+    // Pass ALL_SYMBOLS as symbol_id to reach every book
+    static Command mass_cancel(uint64_t sequence, const MassCancel& filter, uint64_t timestamp = 0,
+                               uint16_t symbol_id = 0) {
+        Command command{};
+        command.sequence = sequence;
+        command.type = CommandType::MASS_CANCEL;
+        command.scope = filter.scope;
+        command.order.side = filter.side;
+        command.order.price = filter.low;
+        command.trigger_price = filter.high;
+        command.order.owner_id = filter.owner_id;
+        command.order.timestamp = timestamp;
+        command.order.symbol_id = symbol_id;
+        return command;
+    }
+    
+    static Command begin_auction(uint64_t sequence, uint64_t timestamp = 0, uint16_t symbol_id = 0) {
+        Command command{};
+        command.sequence = sequence;
+        command.type = CommandType::BEGIN_AUCTION;
+        command.order.timestamp = timestamp;
+        command.order.symbol_id = symbol_id;
+        return command;
+    }
+    
+    static Command uncross(uint64_t sequence, Price reference_price = 0, uint64_t timestamp = 0,
+                           uint16_t symbol_id = 0) {
+        Command command = begin_auction(sequence, timestamp, symbol_id);
+        command.type = CommandType::UNCROSS;
+        command.order.price = reference_price;
+        return command;
+    }
+    
+    MassCancel mass_cancel_filter() const {
+        MassCancel filter;
+        filter.scope = scope;
+        filter.side = order.side;
+        filter.low = order.price;
+        filter.high = trigger_price;
+        filter.owner_id = order.owner_id;
+        return filter;
+    }
+    
+    // MODIFY that also moves the order to `price` (ticks)
+    static Command replace(uint64_t sequence, uint64_t order_id, int quantity, Price price, uint64_t timestamp = 0,
+                           uint16_t symbol_id = 0) {
+        Command command = modify(sequence, order_id, quantity, timestamp, symbol_id);
+        command.order.price = price;
+        return command;
+    }
+};
+
+static_assert(std::is_trivially_copyable<Command>::value, "Command must stay trivially copyable");
+static_assert(sizeof(Command) == 48, "Command is a fixed-width flow file record");
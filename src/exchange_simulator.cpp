@@ -1,5 +1,8 @@
 #include "exchange_simulator.hpp"
 #include "utils/logger.hpp"
+#include "utils/tsc_clock.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <random>
 #include <thread>
 #include <chrono>
@@ -23,7 +26,6 @@ void ExchangeSimulator::run_simulation(int duration_seconds, int orders_per_seco
     std::uniform_int_distribution<> side_dist(0, 1); // 0 = BUY, 1 = SELL
     std::uniform_int_distribution<> type_dist(0, 9); // 90% limit, 10% market
     
-    uint64_t order_id = 1;
     auto start_time = std::chrono::steady_clock::now();
     auto simulation_end = start_time + std::chrono::seconds(duration_seconds);
     
@@ -34,10 +36,11 @@ void ExchangeSimulator::run_simulation(int duration_seconds, int orders_per_seco
         
         // Generate orders for this tick
         for (int i = 0; i < orders_per_second; ++i) {
-            Order order = generate_random_order(order_id++, price_dist, quantity_dist, 
+            Order order = generate_random_order(next_order_id++, price_dist, quantity_dist, 
                                               side_dist, type_dist, gen);
             
-            std::cout << "Submitting: " << order.to_string() << std::endl;
+            std::cout << "Submitting: " << order.to_string(engine.get_order_book().tick_size()) << std::endl;
+            record(Command::add(next_sequence++, order));
             auto fills = engine.process_order(order);
             
             if (!fills.empty()) {
@@ -61,19 +64,138 @@ void ExchangeSimulator::run_simulation(int duration_seconds, int orders_per_seco
     LOG_INFO("Simulation completed");
 }
 
+HeadlessReport ExchangeSimulator::run_headless(size_t order_count, uint32_t seed) {
+    LOG_INFO("Starting headless run: {} orders, seed {}", order_count, seed);
+    
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> price_dist(95.0, 105.0);
+    std::uniform_int_distribution<> quantity_dist(10, 1000);
+    std::uniform_int_distribution<> side_dist(0, 1);
+    std::uniform_int_distribution<> type_dist(0, 9);
+    
+    // Generate the whole flow up front so only matching is timed
+    std::vector<Command> commands;
+    commands.reserve(order_count);
+    for (size_t i = 0; i < order_count; ++i) {
+        Order order = generate_random_order(i + 1, price_dist, quantity_dist, side_dist, type_dist, gen);
+        commands.push_back(Command::add(i + 1, order));
+        record(commands.back());
+    }
+    
+    HeadlessReport report = replay_commands(commands.data(), commands.data() + commands.size(),
+                                            engine.get_order_book().tick_size(), order_count);
+    LOG_INFO("Headless run completed");
+    return report;
+}
+
+bool ExchangeSimulator::run_replay(const std::string& path, HeadlessReport& report) {
+    FlowReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    
+    LOG_INFO("Replaying {} commands from {}", reader.size(), path);
+    report = replay_commands(reader.begin(), reader.end(), reader.tick_size(),
+                             std::min<size_t>(reader.size(), 1 << 20));
+    LOG_INFO("Replay completed");
+    return true;
+}
+
+HeadlessReport ExchangeSimulator::replay_commands(const Command* begin, const Command* end,
+                                                  double tick_size, size_t order_capacity) {
+    // A separate engine, sized for the flow, keeps the interactive book untouched
+    MatchingEngine headless_engine(nullptr, tick_size, order_capacity);
+    HeadlessReport report;
+    report.command_count = static_cast<size_t>(end - begin);
+    size_t fills = 0;
+    auto count_fill = [&fills](const Fill&) { fills++; };
+    double ns_per_tick = TscClock::ns_per_tick();
+    
+    // Nothing inside the timed loop may reach the console
+    LogLevel saved_level = Logger::current_level;
+    Logger::current_level = LogLevel::LOG_OFF;
+    
+    auto start_time = std::chrono::steady_clock::now();
+    for (const Command* command = begin; command != end; ++command) {
+        uint64_t start = TscClock::now();
+        headless_engine.execute(*command, count_fill);
+        uint64_t elapsed = TscClock::now() - start;
+        report.latency.record(static_cast<uint64_t>(elapsed * ns_per_tick));
+    }
+    auto end_time = std::chrono::steady_clock::now();
+    
+    Logger::current_level = saved_level;
+    
+    report.fill_count = fills;
+    report.elapsed_seconds = std::chrono::duration<double>(end_time - start_time).count();
+    report.resting_bids = headless_engine.get_order_book().side_orders(true);
+    report.resting_asks = headless_engine.get_order_book().side_orders(false);
+    return report;
+}
+
+void ExchangeSimulator::print_headless_report(const HeadlessReport& report) {
+    double seconds = report.elapsed_seconds > 0.0 ? report.elapsed_seconds : 1e-9;
+    const LatencyHistogram& latency = report.latency;
+    
+    std::cout << "\n=== HEADLESS RUN ===" << std::endl;
+    std::cout << "Commands: " << report.command_count << " in " << std::fixed << std::setprecision(3)
+              << seconds << " s" << std::endl;
+    std::cout << std::setprecision(0);
+    std::cout << "Commands/sec: " << report.command_count / seconds << std::endl;
+    std::cout << "Fills: " << report.fill_count << " (" << report.fill_count / seconds << "/sec)" << std::endl;
+    std::cout << "Final book: " << report.resting_bids + report.resting_asks << " orders ("
+              << report.resting_bids << " bids, " << report.resting_asks << " asks)" << std::endl;
+    
+    std::cout << "\nLatency per command (ns): min " << latency.min() << ", mean " << std::setprecision(1)
+              << latency.mean() << ", p50 " << latency.percentile(0.50) << ", p99 " << latency.percentile(0.99)
+              << ", p99.9 " << latency.percentile(0.999) << ", max " << latency.max() << std::endl;
+    
+    // Collapse the fine buckets into powers of two for display
+    std::vector<std::pair<uint64_t, uint64_t>> rows;    // lower bound, count
+    latency.for_each_bucket([&rows](uint64_t lower, uint64_t, uint64_t count) {
+        uint64_t bound = 1;
+        while (bound * 2 <= lower) {
+            bound *= 2;
+        }
+        if (lower == 0) {
+            bound = 0;
+        }
+        if (rows.empty() || rows.back().first != bound) {
+            rows.emplace_back(bound, 0);
+        }
+        rows.back().second += count;
+    });
+    
+    uint64_t peak = 0;
+    for (const auto& row : rows) {
+        peak = std::max(peak, row.second);
+    }
+    for (const auto& row : rows) {
+        uint64_t upper = row.first ? row.first * 2 : 1;
+        int bar = static_cast<int>(40 * row.second / std::max<uint64_t>(peak, 1));
+        std::cout << "  [" << std::setw(8) << row.first << ", " << std::setw(8) << upper << ") "
+                  << std::setw(10) << row.second << " " << std::string(bar, '#') << std::endl;
+    }
+    std::cout << "====================\n" << std::endl;
+}
+
 void ExchangeSimulator::run_interactive_mode() {
     std::cout << "\n=== INTERACTIVE MODE ===" << std::endl;
     std::cout << "Commands:" << std::endl;
-    std::cout << "  ADD <SIDE> <TYPE> <PRICE> <QUANTITY> - Add order" << std::endl;
+    std::cout << "  ADD <SIDE> <TYPE> <PRICE> <QUANTITY> [GTC|IOC|FOK] - Add order" << std::endl;
+    std::cout << "  STOP <SIDE> <TRIGGER> <QUANTITY> [LIMIT_PRICE] - Add stop or stop-limit order" << std::endl;
     std::cout << "  CANCEL <ORDER_ID> - Cancel order" << std::endl;
-    std::cout << "  MODIFY <ORDER_ID> <QUANTITY> - Modify order quantity" << std::endl;
+    std::cout << "  MODIFY <ORDER_ID> <QUANTITY> [PRICE] - Amend order (increases and price changes lose priority)" << std::endl;
+    std::cout << "  MASSCANCEL [BUY|SELL [LOW HIGH]] | MASSCANCEL OWNER <ID> - Cancel orders in bulk" << std::endl;
+    std::cout << "  OWNER <ID> - Set the owner stamped on orders entered from now on" << std::endl;
+    std::cout << "  AUCTION - Start a call auction (orders rest until UNCROSS)" << std::endl;
+    std::cout << "  UNCROSS - Execute the auction at its equilibrium price" << std::endl;
     std::cout << "  BOOK - Show order book" << std::endl;
-    std::cout << "  STATS - Show statistics" << std::endl;
+    std::cout << "  STATS [JSON] - Show statistics, optionally as JSON" << std::endl;
     std::cout << "  QUIT - Exit" << std::endl;
     std::cout << "\nExample: ADD BUY LIMIT 100.50 200\n" << std::endl;
     
     std::string command;
-    uint64_t order_id = 1;
     
     while (std::getline(std::cin, command)) {
         if (command.empty()) continue;
@@ -85,15 +207,39 @@ void ExchangeSimulator::run_interactive_mode() {
         if (cmd == "QUIT" || cmd == "quit" || cmd == "q") {
             break;
         } else if (cmd == "ADD" || cmd == "add") {
-            handle_add_command(iss, order_id++);
+            handle_add_command(iss, next_order_id);
+        } else if (cmd == "STOP" || cmd == "stop") {
+            handle_stop_command(iss, next_order_id);
         } else if (cmd == "CANCEL" || cmd == "cancel") {
             handle_cancel_command(iss);
         } else if (cmd == "MODIFY" || cmd == "modify") {
             handle_modify_command(iss);
+        } else if (cmd == "MASSCANCEL" || cmd == "masscancel") {
+            handle_mass_cancel_command(iss);
+        } else if (cmd == "OWNER" || cmd == "owner") {
+            int owner = -1;
+            if (iss >> owner && owner >= 0 && owner <= UINT16_MAX) {
+                session_owner = static_cast<uint16_t>(owner);
+                std::cout << "Orders will be entered for owner " << owner << std::endl;
+            } else {
+                std::cout << "Invalid OWNER command format" << std::endl;
+            }
+        } else if (cmd == "AUCTION" || cmd == "auction") {
+            record(Command::begin_auction(next_sequence++, Order::get_current_timestamp()));
+            engine.begin_auction();
+            std::cout << "Auction started; orders will rest without matching" << std::endl;
+        } else if (cmd == "UNCROSS" || cmd == "uncross") {
+            handle_uncross_command();
         } else if (cmd == "BOOK" || cmd == "book") {
             engine.get_order_book().print_book();
         } else if (cmd == "STATS" || cmd == "stats") {
-            print_statistics();
+            std::string format;
+            iss >> format;
+            if (format == "JSON" || format == "json") {
+                print_statistics_json();
+            } else {
+                print_statistics();
+            }
         } else {
             std::cout << "Unknown command: " << cmd << std::endl;
         }
@@ -109,19 +255,26 @@ void ExchangeSimulator::handle_add_command(std::istringstream& iss, uint64_t ord
         std::cout << "Invalid ADD command format" << std::endl;
         return;
     }
+    std::string time_in_force = "GTC";
+    iss >> time_in_force;
     
     try {
         Order order;
+        double tick_size = engine.get_order_book().tick_size();
         if (type == "LIMIT" || type == "limit") {
-            order = Order::create_limit_order(order_id, price, quantity, side);
+            order = Order::create_limit_order(order_id, price, quantity, side, tick_size);
         } else if (type == "MARKET" || type == "market") {
             order = Order::create_market_order(order_id, quantity, side);
         } else {
             std::cout << "Invalid order type: " << type << std::endl;
             return;
         }
+        order.time_in_force = time_in_force_from_string(time_in_force);
+        order.owner_id = session_owner;
         
-        std::cout << "Adding order: " << order.to_string() << std::endl;
+        std::cout << "Adding order: " << order.to_string(tick_size) << std::endl;
+        record(Command::add(next_sequence++, order));
+        next_order_id++;        // only orders actually submitted take an id
         auto fills = engine.process_order(order);
         
         if (!fills.empty()) {
@@ -130,7 +283,53 @@ void ExchangeSimulator::handle_add_command(std::istringstream& iss, uint64_t ord
                 std::cout << "  " << fill.to_string() << std::endl;
             }
         }
+    
+    } catch (const std::exception& e) {
+        std::cout << "Error creating order: " << e.what() << std::endl;
+    }
+}
+
+void ExchangeSimulator::handle_stop_command(std::istringstream& iss, uint64_t order_id) {
+    std::string side;
+    double trigger = 0.0;
+    int quantity;
+    
+    if (!(iss >> side >> trigger >> quantity)) {
+        std::cout << "Invalid STOP command format" << std::endl;
+        return;
+    }
+    double limit_price = 0.0;
+    bool has_limit = static_cast<bool>(iss >> limit_price);
+    
+    try {
+        double tick_size = engine.get_order_book().tick_size();
+        Price trigger_price = 0;
+        if (!try_price_to_ticks(trigger, tick_size, trigger_price)) {
+            std::cout << "Stop trigger price is out of range" << std::endl;
+            return;
+        }
+        if (trigger <= 0.0 || trigger_price <= 0) {
+            std::cout << "Stop trigger price must be positive" << std::endl;
+            return;
+        }
+        Order order = has_limit ? Order::create_limit_order(order_id, limit_price, quantity, side, tick_size)
+                                : Order::create_market_order(order_id, quantity, side);
+        order.owner_id = session_owner;
+        
+        std::cout << "Adding stop at " << ticks_to_price(trigger_price, tick_size) << ": "
+                  << order.to_string(tick_size) << std::endl;
+        record(Command::add_stop(next_sequence++, order, trigger_price));
+        next_order_id++;
+        std::vector<Fill> fills;
+        engine.submit_stop(order, trigger_price, fills);
         
+        if (!fills.empty()) {
+            std::cout << "Triggered, generated " << fills.size() << " fills:" << std::endl;
+            for (const auto& fill : fills) {
+                std::cout << "  " << fill.to_string() << std::endl;
+            }
+        }
+    
     } catch (const std::exception& e) {
         std::cout << "Error creating order: " << e.what() << std::endl;
     }
@@ -143,6 +342,7 @@ void ExchangeSimulator::handle_cancel_command(std::istringstream& iss) {
         return;
     }
     
+    record(Command::cancel(next_sequence++, order_id, Order::get_current_timestamp()));
     if (engine.cancel_order(order_id)) {
         std::cout << "Order " << order_id << " cancelled successfully" << std::endl;
     } else {
@@ -158,20 +358,102 @@ void ExchangeSimulator::handle_modify_command(std::istringstream& iss) {
         std::cout << "Invalid MODIFY command format" << std::endl;
         return;
     }
+    double new_price = 0.0;
+    bool has_price = static_cast<bool>(iss >> new_price);
+    
+    Price price_ticks = 0;
+    if (has_price) {
+        if (!try_price_to_ticks(new_price, engine.get_order_book().tick_size(), price_ticks)) {
+            std::cout << "Order price is out of range" << std::endl;
+            return;
+        }
+        if (new_price <= 0.0 || price_ticks <= 0) {
+            std::cout << "Order price must be positive" << std::endl;
+            return;
+        }
+    }
     
-    if (engine.modify_order(order_id, new_quantity)) {
+    uint64_t timestamp = Order::get_current_timestamp();
+    record(Command::replace(next_sequence++, order_id, new_quantity, price_ticks, timestamp));
+    std::vector<Fill> fills;
+    if (engine.modify_order(order_id, new_quantity, price_ticks, fills, timestamp)) {
         std::cout << "Order " << order_id << " modified successfully" << std::endl;
+        if (!fills.empty()) {
+            std::cout << "Generated " << fills.size() << " fills:" << std::endl;
+            for (const auto& fill : fills) {
+                std::cout << "  " << fill.to_string() << std::endl;
+            }
+        }
     } else {
         std::cout << "Order " << order_id << " not found or invalid quantity" << std::endl;
     }
 }
 
+void ExchangeSimulator::handle_mass_cancel_command(std::istringstream& iss) {
+    std::string scope;
+    MassCancel filter;
+    if (iss >> scope) {
+        if (scope == "OWNER" || scope == "owner") {
+            int owner = -1;
+            if (!(iss >> owner) || owner < 0 || owner > UINT16_MAX) {
+                std::cout << "Invalid MASSCANCEL command format" << std::endl;
+                return;
+            }
+            filter = MassCancel::of_owner(static_cast<uint16_t>(owner));
+        } else {
+            Side side;
+            if (scope == "BUY" || scope == "buy") {
+                side = Side::BUY;
+            } else if (scope == "SELL" || scope == "sell") {
+                side = Side::SELL;
+            } else {
+                std::cout << "Invalid MASSCANCEL command format" << std::endl;
+                return;
+            }
+            filter = MassCancel::of_side(side);
+            double low = 0.0;
+            double high = 0.0;
+            if (iss >> low) {
+                if (!(iss >> high) || low > high) {
+                    std::cout << "Invalid MASSCANCEL price range" << std::endl;
+                    return;
+                }
+                const OrderBook& book = engine.get_order_book();
+                filter = MassCancel::price_range(side, book.to_ticks(low), book.to_ticks(high));
+            }
+        }
+    }
+    
+    record(Command::mass_cancel(next_sequence++, filter, Order::get_current_timestamp()));
+    size_t cancelled = engine.mass_cancel(filter);
+    std::cout << "Cancelled " << cancelled << " orders" << std::endl;
+}
+
+void ExchangeSimulator::handle_uncross_command() {
+    if (!engine.in_auction()) {
+        std::cout << "No auction in progress" << std::endl;
+        return;
+    }
+    
+    record(Command::uncross(next_sequence++, 0, Order::get_current_timestamp()));
+    AuctionResult result = engine.uncross([](const Fill& fill) {
+        std::cout << "  " << fill.to_string() << std::endl;
+    });
+    if (!result.crossed) {
+        std::cout << "Auction closed without a cross" << std::endl;
+        return;
+    }
+    std::cout << "Uncrossed " << result.volume << " at " << engine.get_order_book().to_price(result.price)
+              << " in " << result.fills << " fills (imbalance " << result.imbalance << ")" << std::endl;
+}
+
 void ExchangeSimulator::print_statistics() const {
     std::cout << "\n=== STATISTICS ===" << std::endl;
     std::cout << "Total Fills: " << engine.total_fills() << std::endl;
     std::cout << "Total Volume: $" << std::fixed << std::setprecision(2) 
               << engine.total_volume() << std::endl;
     std::cout << "Orders in Book: " << engine.get_order_book().total_orders() << std::endl;
+    std::cout << "Pending Stops: " << engine.get_stop_book().size() << std::endl;
     
     TopOfBook tob = engine.get_order_book().get_top_of_book();
     if (tob.best_bid && tob.best_ask) {
@@ -181,13 +463,64 @@ void ExchangeSimulator::print_statistics() const {
     } else {
         std::cout << "No top of book available" << std::endl;
     }
+
+#if LOB_STAGE_TIMING
+    std::cout << "\nStage latency:" << std::endl;
+    engine.stage_stats().print(std::cout);
+#endif
     std::cout << "==================\n" << std::endl;
 }
 
+void ExchangeSimulator::print_statistics_json() const {
+    std::cout << "{\"fills\": " << engine.total_fills()
+              << ", \"volume\": " << std::fixed << std::setprecision(2) << engine.total_volume()
+              << ", \"orders\": " << engine.get_order_book().total_orders()
+              << ", \"stops\": " << engine.get_stop_book().size()
+              << ", \"stages\": ";
+#if LOB_STAGE_TIMING
+    engine.stage_stats().write_json(std::cout);
+#else
+    std::cout << "null";
+#endif
+    std::cout << "}" << std::endl;
+}
+
+bool ExchangeSimulator::open_journal(const std::string& journal_path, const std::string& snapshot_path,
+                                     uint64_t snapshot_interval, RecoveryStats& stats) {
+    if (!recover_engine(snapshot_path, journal_path, engine, stats) ||
+        !journal.open(journal_path, engine.get_order_book().tick_size())) {
+        return false;
+    }
+    this->snapshot_path = snapshot_path;
+    this->snapshot_interval = snapshot_interval;
+    snapshot_sequence = stats.snapshot_sequence;
+    
+    // Every command takes one sequence and at most one order id, so no id past
+    // the last recovered sequence was ever handed out
+    next_sequence = stats.last_sequence + 1;
+    next_order_id = std::max(next_order_id, next_sequence);
+    return true;
+}
+
+void ExchangeSimulator::journal_command(const Command& command) {
+    // Each command is applied before the next is recorded, so the book here
+    // reflects exactly the journal up to the previous command
+    uint64_t applied = command.sequence - 1;
+    if (snapshot_interval && !snapshot_path.empty() && applied - snapshot_sequence >= snapshot_interval &&
+        save_snapshot(engine, applied, snapshot_path)) {
+        snapshot_sequence = applied;
+        journal.truncate();
+    }
+    if (!journal.append(command)) {
+        LOG_ERROR("Cannot journal command {}", command.sequence);
+    }
+}
+
 void ExchangeSimulator::on_fill(const Fill& fill) {
     // This callback is called whenever a fill occurs
     // Can be used for real-time processing, logging, etc.
-    LOG_INFO("Fill executed: " + fill.to_string());
+    LOG_INFO("Fill executed: BuyID={} SellID={} Price={} Qty={}",
+             fill.buy_order_id, fill.sell_order_id, fill.price, fill.quantity);
 }
 
 Order ExchangeSimulator::generate_random_order(uint64_t order_id,
@@ -197,12 +530,13 @@ Order ExchangeSimulator::generate_random_order(uint64_t order_id,
     std::uniform_int_distribution<>& type_dist,
     std::mt19937& gen) {
     
-    std::string side = (side_dist(gen) == 0) ? "BUY" : "SELL";
+    Side side = (side_dist(gen) == 0) ? Side::BUY : Side::SELL;
     bool is_market = (type_dist(gen) == 0); // 10% chance for market order
     
     if (is_market) {
-        return Order::create_market_order(order_id, quantity_dist(gen), side);
+        return Order::market_order(order_id, quantity_dist(gen), side);
     } else {
-        return Order::create_limit_order(order_id, price_dist(gen), quantity_dist(gen), side);
+        Price price = engine.get_order_book().to_ticks(price_dist(gen));
+        return Order::limit_order(order_id, price, quantity_dist(gen), side);
     }
 }
@@ -1,11 +1,25 @@
 #pragma once
 
+#include "journal.hpp"
 #include "matching_engine.hpp"
+#include "order_flow.hpp"
+#include "snapshot.hpp"
+#include "utils/latency_histogram.hpp"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <random>
 
+// Outcome of a headless run; latency is per process_order call in nanoseconds
+struct HeadlessReport {
+    size_t command_count = 0;
+    size_t fill_count = 0;
+    double elapsed_seconds = 0.0;
+    size_t resting_bids = 0;
+    size_t resting_asks = 0;
+    LatencyHistogram latency;
+};
+
 class ExchangeSimulator {
 public:
     ExchangeSimulator();
@@ -14,20 +28,64 @@ public:
     void run_simulation(int duration_seconds = 10, int orders_per_second = 2);
     void run_interactive_mode();
     
+    // Pushes `order_count` pre-generated orders through a fresh engine as fast
+    // as possible; the same seed always produces the same order flow
+    HeadlessReport run_headless(size_t order_count, uint32_t seed = 42);
+    
+    // Streams a recorded flow file through a fresh engine, straight from the mapping
+    bool run_replay(const std::string& path, HeadlessReport& report);
+    static void print_headless_report(const HeadlessReport& report);
+    
     // Access to matching engine
     MatchingEngine& get_engine() { return engine; }
     const MatchingEngine& get_engine() const { return engine; }
     
+    // Every command the simulator submits is also written to `recorder`
+    void set_recorder(FlowRecorder* recorder) { this->recorder = recorder; }
+    
+    // Makes the interactive and simulation book survive restarts. Rebuilds it
+    // from `snapshot_path` and `journal_path` (either may be missing), then
+    // journals every command before applying it. Every `snapshot_interval`
+    // commands (0 = never) the book is snapshotted and the journal truncated.
+    // Call once, before running a mode.
+    bool open_journal(const std::string& journal_path, const std::string& snapshot_path,
+                      uint64_t snapshot_interval, RecoveryStats& stats);
+
 private:
     MatchingEngine engine;
+    FlowRecorder* recorder = nullptr;
+    Journal journal;
+    std::string snapshot_path;
+    uint64_t snapshot_interval = 0;
+    uint64_t snapshot_sequence = 0;     // last command the latest snapshot covers
+    uint64_t next_sequence = 1;
+    uint64_t next_order_id = 1;
+    uint16_t session_owner = 0;     // stamped on interactive orders, set with OWNER
+    
+    void record(const Command& command) {
+        if (recorder) {
+            recorder->record(command);
+        }
+        if (journal.is_open()) {
+            journal_command(command);
+        }
+    }
+    void journal_command(const Command& command);
+    
+    HeadlessReport replay_commands(const Command* begin, const Command* end,
+                                   double tick_size, size_t order_capacity);
     
     // Command handlers
     void handle_add_command(std::istringstream& iss, uint64_t order_id);
+    void handle_stop_command(std::istringstream& iss, uint64_t order_id);
     void handle_cancel_command(std::istringstream& iss);
     void handle_modify_command(std::istringstream& iss);
+    void handle_mass_cancel_command(std::istringstream& iss);
+    void handle_uncross_command();
     
     // Utility methods
     void print_statistics() const;
+    void print_statistics_json() const;
     void on_fill(const Fill& fill);
     
     // Random order generation
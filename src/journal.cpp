@@ -0,0 +1,212 @@
+#include "journal.hpp"
+#include "utils/logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Bytes actually written, which is less than size only on an error
+size_t write_all(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t written = ::write(fd, bytes + done, size - done);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += static_cast<size_t>(written);
+    }
+    return done;
+}
+
+}  // namespace
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::open(const std::string& path, double tick_size, const JournalConfig& journal_config) {
+    close();
+    
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open journal {}", path);
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        LOG_ERROR("Cannot stat journal {}", path);
+        close();
+        return false;
+    }
+    
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size < sizeof(FlowFileHeader)) {
+        FlowFileHeader header{};
+        std::memcpy(header.magic, FLOW_FILE_MAGIC, sizeof(header.magic));
+        header.version = FLOW_FILE_VERSION;
+        header.record_size = sizeof(Command);
+        header.tick_size = tick_size;
+        if (ftruncate(fd, 0) != 0 || write_all(fd, &header, sizeof(header)) != sizeof(header) || fsync(fd) != 0) {
+            LOG_ERROR("Cannot write journal header to {}", path);
+            close();
+            return false;
+        }
+        size = sizeof(header);
+    } else {
+        FlowFileHeader header;
+        if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            std::memcmp(header.magic, FLOW_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != FLOW_FILE_VERSION || header.record_size != sizeof(Command)) {
+            LOG_ERROR("{} is not a version {} journal", path, FLOW_FILE_VERSION);
+            close();
+            return false;
+        }
+        if (header.tick_size != tick_size) {
+            LOG_ERROR("Journal {} has tick size {}, expected {}", path, header.tick_size, tick_size);
+            close();
+            return false;
+        }
+        
+        // A crash mid-write can leave part of a record at the end
+        size_t records = (size - sizeof(header)) / sizeof(Command);
+        size_t whole = sizeof(header) + records * sizeof(Command);
+        if (whole != size && ftruncate(fd, static_cast<off_t>(whole)) != 0) {
+            LOG_ERROR("Cannot trim torn record from journal {}", path);
+            close();
+            return false;
+        }
+        size = whole;
+    }
+    
+    if (lseek(fd, static_cast<off_t>(size), SEEK_SET) < 0) {
+        LOG_ERROR("Cannot seek to the end of journal {}", path);
+        close();
+        return false;
+    }
+    
+    file_path = path;
+    config = journal_config;
+    buffer.clear();
+    buffer.reserve(config.group_commit_records);
+    written_bytes = 0;
+    count = 0;
+    commit_count = 0;
+    stopping = false;
+    flusher = std::thread(&Journal::run_flusher, this);
+    return true;
+}
+
+bool Journal::append(const Command& command) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) {
+        return false;
+    }
+    
+    if (buffer.empty()) {
+        oldest_pending = std::chrono::steady_clock::now();
+        wake.notify_one();      // the flusher now has a deadline to wait for
+    }
+    buffer.push_back(command);
+    count++;
+    
+    if (buffer.size() >= config.group_commit_records ||
+        std::chrono::steady_clock::now() - oldest_pending >= config.group_commit_interval) {
+        return commit_locked();
+    }
+    return true;
+}
+
+bool Journal::commit() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commit_locked();
+}
+
+// Sleeps until the oldest pending record is due, then commits its group
+void Journal::run_flusher() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (buffer.empty()) {
+            wake.wait(lock);
+            continue;
+        }
+        auto deadline = oldest_pending + config.group_commit_interval;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            if (!commit_locked()) {
+                wake.wait_for(lock, config.group_commit_interval);     // retry later rather than spin
+            }
+        } else {
+            wake.wait_until(lock, deadline);
+        }
+    }
+}
+
+bool Journal::commit_locked() {
+    if (fd < 0 || buffer.empty()) {
+        return fd >= 0;
+    }
+    
+    // After a short write the file already holds a prefix of the group, so
+    // a retry resumes where it stopped instead of repeating those records
+    const char* bytes = reinterpret_cast<const char*>(buffer.data());
+    size_t total = buffer.size() * sizeof(Command);
+    written_bytes += write_all(fd, bytes + written_bytes, total - written_bytes);
+    if (written_bytes < total) {
+        LOG_ERROR("Short write to journal {} after {} records", file_path, count);
+        return false;
+    }
+    
+    // Written records are not written again even if the sync fails; the next
+    // successful sync covers them
+    buffer.clear();
+    written_bytes = 0;
+    if (config.sync && fdatasync(fd) != 0) {
+        LOG_ERROR("Cannot sync journal {}", file_path);
+        return false;
+    }
+    commit_count++;
+    return true;
+}
+
+bool Journal::truncate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!commit_locked()) {
+        return false;
+    }
+    
+    if (ftruncate(fd, sizeof(FlowFileHeader)) != 0 ||
+        lseek(fd, sizeof(FlowFileHeader), SEEK_SET) < 0 ||
+        (config.sync && fdatasync(fd) != 0)) {
+        LOG_ERROR("Cannot truncate journal {}", file_path);
+        return false;
+    }
+    return true;
+}
+
+bool Journal::close() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        flusher.join();
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) {
+        return true;
+    }
+    
+    bool ok = commit_locked();
+    if (::close(fd) != 0) {
+        ok = false;
+    }
+    fd = -1;
+    return ok;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "command.hpp"
+#include "order_flow.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct JournalConfig {
+    size_t group_commit_records = 512;                          // commit once this many are pending
+    std::chrono::microseconds group_commit_interval{2000};      // ... or the oldest has waited this long
+    bool sync = true;                                           // fdatasync on every commit
+};
+
+// Append-only write-ahead log of accepted commands. The file is a flow file
+// whose header count stays 0, so FlowReader (and `replay`) trust the file size
+// and a torn trailing record is simply ignored. Records are written and synced
+// in groups so one fdatasync covers many commands. A background flusher
+// commits a group once its oldest record reaches group_commit_interval, even
+// if nothing else is appended.
+class Journal {
+public:
+    Journal() = default;
+    ~Journal();
+    
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    
+    // Opens for appending, creating the file if needed; an existing journal
+    // must have the same tick size and is trimmed to its last whole record
+    bool open(const std::string& path, double tick_size, const JournalConfig& config = JournalConfig());
+    
+    // Queues a command; commits the group when either threshold is reached
+    bool append(const Command& command);
+    
+    // Writes and syncs everything pending
+    bool commit();
+    
+    // Drops every record, once a snapshot covers them
+    bool truncate();
+    
+    bool close();
+    
+    bool is_open() const { return fd >= 0; }
+    uint64_t appended() const { std::lock_guard<std::mutex> lock(mutex); return count; }
+    uint64_t commits() const { std::lock_guard<std::mutex> lock(mutex); return commit_count; }
+    size_t pending() const { std::lock_guard<std::mutex> lock(mutex); return buffer.size(); }
+
+private:
+    bool commit_locked();
+    void run_flusher();
+    
+    // Guards everything below against the flusher thread
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::thread flusher;
+    bool stopping = false;
+    
+    int fd = -1;
+    std::string file_path;
+    JournalConfig config;
+    std::vector<Command> buffer;
+    size_t written_bytes = 0;       // prefix of buffer already in the file after a short write
+    std::chrono::steady_clock::time_point oldest_pending;
+    uint64_t count = 0;
+    uint64_t commit_count = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "order.hpp"
+#include "order_book.hpp"
+#include <map>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+// Reference order book built on std::map price levels and std::deque queues.
+// Kept alongside the tick ladder in OrderBook so the two can be benchmarked side by side.
+class MapOrderBook {
+public:
+    explicit MapOrderBook(double tick_size = DEFAULT_TICK_SIZE) : tick(tick_size) {}
+    
+    // Core order management
+    bool add_order(const Order& order);
+    bool cancel_order(uint64_t order_id);
+    bool reduce_order(uint64_t order_id, int new_quantity);
+    
+    // Book information
+    TopOfBook get_top_of_book() const;
+    std::vector<PriceLevel> get_bid_levels(int depth = 5) const;
+    std::vector<PriceLevel> get_ask_levels(int depth = 5) const;
+    
+    // Display
+    void print_book(int depth = 5) const;
+    
+    // Matching access: resting liquidity on one side of the book
+    bool has_orders(bool buy_side) const;
+    Price best_price(bool buy_side) const;
+    Order& front_order(bool buy_side);
+    void consume_front(bool buy_side, int quantity);
+    
+    // Internal access to the raw price maps
+    std::map<Price, std::deque<Order>, std::greater<Price>>& get_buy_orders() { return buy_orders; }
+    std::map<Price, std::deque<Order>>& get_sell_orders() { return sell_orders; }
+    
+    const std::map<Price, std::deque<Order>, std::greater<Price>>& get_buy_orders() const { return buy_orders; }
+    const std::map<Price, std::deque<Order>>& get_sell_orders() const { return sell_orders; }
+    
+    // Statistics
+    size_t total_orders() const;
+    bool empty() const;
+    
+private:
+    double tick;
+    
+    // Buy orders: price -> queue of orders (sorted descending by price)
+    std::map<Price, std::deque<Order>, std::greater<Price>> buy_orders;
+    
+    // Sell orders: price -> queue of orders (sorted ascending by price)
+    std::map<Price, std::deque<Order>> sell_orders;
+    
+    // Order ID to location mapping for fast cancellation
+    std::unordered_map<uint64_t, std::pair<Price, bool>> order_locations; // price, is_buy
+    
+    // Helper methods
+    void remove_order_from_level(uint64_t order_id, Price price, bool is_buy);
+    void clean_empty_levels();
+    int calculate_level_quantity(const std::deque<Order>& orders) const;
+};
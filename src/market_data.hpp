@@ -0,0 +1,23 @@
+#pragma once
+
+#include "order.hpp"
+#include "price.hpp"
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+// Level 2 delta: the new state of one price level after an add, fill, cancel
+// or modify touched it. total_quantity == 0 means the level is gone.
+// `sequence` increases by one per update so consumers can detect gaps.
+struct LevelUpdate {
+    uint64_t sequence;
+    Price price;            // ticks
+    int total_quantity;
+    int order_count;
+    Side side;
+};
+
+static_assert(std::is_trivially_copyable<LevelUpdate>::value, "LevelUpdate must stay trivially copyable");
+static_assert(sizeof(LevelUpdate) == 24, "LevelUpdate should stay compact");
+
+using LevelUpdateCallback = std::function<void(const LevelUpdate&)>;
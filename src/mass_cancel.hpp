@@ -0,0 +1,61 @@
+#pragma once
+
+#include "order.hpp"
+#include "price.hpp"
+#include <cstdint>
+
+enum class MassCancelScope : uint8_t {
+    ALL,
+    SIDE,           // every order on `side`
+    PRICE_RANGE,    // resting orders on `side` priced within [low, high]
+    OWNER           // every order entered by `owner_id`
+};
+
+// Which orders a mass cancel withdraws. Pending stops are covered by every
+// scope except PRICE_RANGE, which only looks at resting limit prices.
+struct MassCancel {
+    MassCancelScope scope = MassCancelScope::ALL;
+    Side side = Side::BUY;
+    Price low = 0;          // ticks, inclusive
+    Price high = 0;
+    uint16_t owner_id = 0;
+
+    static MassCancel all() { return MassCancel(); }
+
+    static MassCancel of_side(Side side) {
+        MassCancel filter;
+        filter.scope = MassCancelScope::SIDE;
+        filter.side = side;
+        return filter;
+    }
+
+    static MassCancel price_range(Side side, Price low, Price high) {
+        MassCancel filter = of_side(side);
+        filter.scope = MassCancelScope::PRICE_RANGE;
+        filter.low = low;
+        filter.high = high;
+        return filter;
+    }
+
+    static MassCancel of_owner(uint16_t owner_id) {
+        MassCancel filter;
+        filter.scope = MassCancelScope::OWNER;
+        filter.owner_id = owner_id;
+        return filter;
+    }
+
+    // Whether the filter selects `order`; for a stop, price range never matches
+    bool matches(const Order& order, bool resting = true) const {
+        switch (scope) {
+            case MassCancelScope::ALL:
+                return true;
+            case MassCancelScope::SIDE:
+                return order.side == side;
+            case MassCancelScope::PRICE_RANGE:
+                return resting && order.side == side && order.price >= low && order.price <= high;
+            case MassCancelScope::OWNER:
+                return order.owner_id == owner_id;
+        }
+        return false;
+    }
+};
@@ -2,7 +2,7 @@
 #include "utils/logger.hpp"
 #include <sstream>
 #include <algorithm>
-#include <limits>
+#include <cstdlib>
 
 std::string Fill::to_string() const {
     std::stringstream ss;
@@ -14,240 +14,179 @@ std::string Fill::to_string() const {
     return ss.str();
 }
 
-MatchingEngine::MatchingEngine(FillCallback callback) 
-    : fill_callback(callback) {
+MatchingEngine::MatchingEngine(FillCallback callback, double tick_size, size_t order_capacity) 
+    : order_book(tick_size, 1024, order_capacity), fill_callback(callback) {
     LOG_INFO("MatchingEngine initialized");
 }
 
 std::vector<Fill> MatchingEngine::process_order(const Order& order) {
-    LOG_INFO("Processing order: " + order.to_string());
-    
     std::vector<Fill> fills;
-    
-    if (order.is_limit()) {
-        fills = match_limit_order(order);
-    } else if (order.is_market()) {
-        fills = match_market_order(order);
-    } else {
-        LOG_ERROR("Unknown order type: " + order.type);
-        return fills;
-    }
-    
-    // Notify about fills
-    for (const auto& fill : fills) {
-        notify_fill(fill);
-        update_statistics(fill);
-    }
-    
-    LOG_INFO("Generated " + std::to_string(fills.size()) + " fills");
+    process_order(order, fills);
     return fills;
 }
 
-bool MatchingEngine::cancel_order(uint64_t order_id) {
-    return order_book.cancel_order(order_id);
+size_t MatchingEngine::process_order(const Order& order, std::vector<Fill>& fills) {
+    return process_order(order, [&fills](const Fill& fill) { fills.push_back(fill); });
 }
 
-bool MatchingEngine::modify_order(uint64_t order_id, int new_quantity) {
-    return order_book.modify_order(order_id, new_quantity);
+size_t MatchingEngine::submit_stop(const Order& order, Price trigger_price, std::vector<Fill>& fills) {
+    return submit_stop(order, trigger_price, [&fills](const Fill& fill) { fills.push_back(fill); });
 }
 
-std::vector<Fill> MatchingEngine::match_limit_order(const Order& order) {
-    std::vector<Fill> fills;
-    Order remaining_order = order;
-    
-    if (order.is_buy()) {
-        auto& sell_orders = order_book.get_sell_orders();
-        
-        for (auto it = sell_orders.begin(); 
-             it != sell_orders.end() && remaining_order.quantity > 0;) {
-            
-            double ask_price = it->first;
-            auto& sell_queue = it->second;
-            
-            // Check if we can match at this price level
-            if (remaining_order.price < ask_price) {
-                break; // No more matching possible
-            }
-            
-            // Match orders at this price level (FIFO)
-            while (!sell_queue.empty() && remaining_order.quantity > 0) {
-                Order& passive_order = sell_queue.front();
-                
-                int fill_quantity = std::min(remaining_order.quantity, passive_order.quantity);
-                double fill_price = determine_fill_price(remaining_order, passive_order);
-                
-                Fill fill = create_fill(remaining_order, passive_order, fill_price, fill_quantity);
-                fills.push_back(fill);
-                
-                // Update quantities
-                remaining_order.quantity -= fill_quantity;
-                passive_order.quantity -= fill_quantity;
-                
-                // Remove fully filled orders
-                if (passive_order.quantity == 0) {
-                    LOG_DEBUG("Removing fully filled passive sell order " + 
-                             std::to_string(passive_order.order_id));
-                    sell_queue.pop_front();
-                }
-            }
-            
-            // Remove empty price levels
-            if (sell_queue.empty()) {
-                it = sell_orders.erase(it);
-            } else {
-                ++it;
-            }
-        }
-    } else { // Sell order
-        auto& buy_orders = order_book.get_buy_orders();
-        
-        for (auto it = buy_orders.begin(); 
-             it != buy_orders.end() && remaining_order.quantity > 0;) {
-            
-            double bid_price = it->first;
-            auto& buy_queue = it->second;
-            
-            // Check if we can match at this price level
-            if (remaining_order.price > bid_price) {
-                break; // No more matching possible
-            }
-            
-            // Match orders at this price level (FIFO)
-            while (!buy_queue.empty() && remaining_order.quantity > 0) {
-                Order& passive_order = buy_queue.front();
-                
-                int fill_quantity = std::min(remaining_order.quantity, passive_order.quantity);
-                double fill_price = determine_fill_price(remaining_order, passive_order);
-                
-                Fill fill = create_fill(passive_order, remaining_order, fill_price, fill_quantity);
-                fills.push_back(fill);
-                
-                // Update quantities
-                remaining_order.quantity -= fill_quantity;
-                passive_order.quantity -= fill_quantity;
-                
-                // Remove fully filled orders
-                if (passive_order.quantity == 0) {
-                    LOG_DEBUG("Removing fully filled passive buy order " + 
-                             std::to_string(passive_order.order_id));
-                    buy_queue.pop_front();
-                }
-            }
-            
-            // Remove empty price levels
-            if (buy_queue.empty()) {
-                it = buy_orders.erase(it);
-            } else {
-                ++it;
-            }
-        }
+AuctionResult MatchingEngine::uncross(std::vector<Fill>& fills, Price reference_price) {
+    return uncross([&fills](const Fill& fill) { fills.push_back(fill); }, reference_price);
+}
+
+size_t MatchingEngine::process_batch(const Command* commands, size_t count, std::vector<Fill>& fills) {
+    return process_batch(commands, count, [&fills](const Fill& fill) { fills.push_back(fill); });
+}
+
+void MatchingEngine::begin_auction() {
+    auction_phase = true;
+    LOG_INFO("Auction phase started");
+}
+
+AuctionResult MatchingEngine::indicative_auction(Price reference_price) const {
+    AuctionResult result;
+    if (!order_book.has_orders(true) || !order_book.has_orders(false)) {
+        return result;
     }
     
-    // Add remaining quantity to book if any
-    if (remaining_order.quantity > 0) {
-        LOG_DEBUG("Adding remaining quantity " + std::to_string(remaining_order.quantity) + 
-                 " to order book");
-        order_book.add_order(remaining_order);
+    // Only prices between the best ask and the best bid can trade
+    Price low = order_book.best_price(false);
+    Price high = order_book.best_price(true);
+    if (high < low) {
+        return result;
     }
     
-    return fills;
-}
-
-std::vector<Fill> MatchingEngine::match_market_order(const Order& order) {
-    std::vector<Fill> fills;
-    Order remaining_order = order;
+    // The populated levels inside that range, both ascending
+    struct LevelQuantity {
+        Price price;
+        int64_t quantity;
+    };
+    std::vector<LevelQuantity> bids;
+    std::vector<LevelQuantity> asks;
+    int64_t buy_volume = 0;
+    order_book.for_each_level(true, [&](Price price, int quantity) {
+        if (price < low) return false;
+        bids.push_back({price, quantity});
+        buy_volume += quantity;
+        return true;
+    });
+    std::reverse(bids.begin(), bids.end());
+    order_book.for_each_level(false, [&](Price price, int quantity) {
+        if (price > high) return false;
+        asks.push_back({price, quantity});
+        return true;
+    });
     
-    if (order.is_buy()) {
-        auto& sell_orders = order_book.get_sell_orders();
-        
-        for (auto it = sell_orders.begin(); 
-             it != sell_orders.end() && remaining_order.quantity > 0;) {
-            
-            auto& sell_queue = it->second;
-            
-            // Match orders at this price level (FIFO)
-            while (!sell_queue.empty() && remaining_order.quantity > 0) {
-                Order& passive_order = sell_queue.front();
-                
-                int fill_quantity = std::min(remaining_order.quantity, passive_order.quantity);
-                double fill_price = passive_order.price; // Market order takes the passive price
-                
-                Fill fill = create_fill(remaining_order, passive_order, fill_price, fill_quantity);
-                fills.push_back(fill);
-                
-                // Update quantities
-                remaining_order.quantity -= fill_quantity;
-                passive_order.quantity -= fill_quantity;
-                
-                // Remove fully filled orders
-                if (passive_order.quantity == 0) {
-                    sell_queue.pop_front();
-                }
-            }
-            
-            // Remove empty price levels
-            if (sell_queue.empty()) {
-                it = sell_orders.erase(it);
-            } else {
-                ++it;
-            }
+    // Bids at or above p and asks at or below p only change where an ask level
+    // starts or just past a bid level, so p walks those breakpoints and each
+    // run of ticks in between is one candidate range
+    struct Candidate {
+        Price first;
+        Price last;
+        int64_t surplus;
+    };
+    std::vector<Candidate> candidates;
+    int64_t sell_volume = 0;
+    int64_t best_volume = -1;
+    int64_t best_surplus = 0;
+    bool buy_pressure = false;
+    bool sell_pressure = false;
+    size_t next_bid = 0;
+    size_t next_ask = 0;
+    for (Price price = low; price <= high;) {
+        for (; next_ask < asks.size() && asks[next_ask].price == price; ++next_ask) {
+            sell_volume += asks[next_ask].quantity;
+        }
+        for (; next_bid < bids.size() && bids[next_bid].price + 1 == price; ++next_bid) {
+            buy_volume -= bids[next_bid].quantity;
+        }
+        Price next = high + 1;
+        if (next_ask < asks.size()) {
+            next = std::min(next, asks[next_ask].price);
+        }
+        if (next_bid < bids.size()) {
+            next = std::min(next, bids[next_bid].price + 1);
         }
-    } else { // Market sell order
-        auto& buy_orders = order_book.get_buy_orders();
         
-        for (auto it = buy_orders.begin(); 
-             it != buy_orders.end() && remaining_order.quantity > 0;) {
-            
-            auto& buy_queue = it->second;
-            
-            // Match orders at this price level (FIFO)
-            while (!buy_queue.empty() && remaining_order.quantity > 0) {
-                Order& passive_order = buy_queue.front();
-                
-                int fill_quantity = std::min(remaining_order.quantity, passive_order.quantity);
-                double fill_price = passive_order.price; // Market order takes the passive price
-                
-                Fill fill = create_fill(passive_order, remaining_order, fill_price, fill_quantity);
-                fills.push_back(fill);
-                
-                // Update quantities
-                remaining_order.quantity -= fill_quantity;
-                passive_order.quantity -= fill_quantity;
-                
-                // Remove fully filled orders
-                if (passive_order.quantity == 0) {
-                    buy_queue.pop_front();
-                }
-            }
-            
-            // Remove empty price levels
-            if (buy_queue.empty()) {
-                it = buy_orders.erase(it);
-            } else {
-                ++it;
-            }
+        int64_t volume = std::min(buy_volume, sell_volume);
+        int64_t surplus = buy_volume - sell_volume;
+        if (volume > best_volume || (volume == best_volume && std::llabs(surplus) < std::llabs(best_surplus))) {
+            best_volume = volume;
+            best_surplus = surplus;
+            candidates.clear();
+            buy_pressure = false;
+            sell_pressure = false;
+        }
+        if (volume == best_volume && std::llabs(surplus) == std::llabs(best_surplus)) {
+            candidates.push_back({price, next - 1, surplus});
+            buy_pressure |= surplus > 0;
+            sell_pressure |= surplus < 0;
         }
+        price = next;
     }
     
-    // Market orders that can't be filled are rejected
-    if (remaining_order.quantity > 0) {
-        LOG_ERROR("Market order " + std::to_string(order.order_id) + 
-                 " partially rejected - remaining quantity: " + 
-                 std::to_string(remaining_order.quantity));
+    // Buy pressure takes the highest candidate price, sell pressure the lowest,
+    // otherwise the one nearest the reference (or the middle), lower on a tie
+    const Candidate* chosen = &candidates.front();
+    Price chosen_price = chosen->first;
+    if (buy_pressure && !sell_pressure) {
+        chosen = &candidates.back();
+        chosen_price = chosen->last;
+    } else if (buy_pressure == sell_pressure) {
+        int64_t target = reference_price > 0
+            ? reference_price
+            : candidates.front().first + (candidates.back().last - candidates.front().first) / 2;
+        for (const Candidate& candidate : candidates) {
+            Price nearest = static_cast<Price>(std::clamp<int64_t>(target, candidate.first, candidate.last));
+            if (std::llabs(nearest - target) < std::llabs(chosen_price - target)) {
+                chosen = &candidate;
+                chosen_price = nearest;
+            }
+        }
     }
     
-    return fills;
+    result.crossed = true;
+    result.price = chosen_price;
+    result.volume = best_volume;
+    result.imbalance = chosen->surplus;
+    return result;
+}
+
+bool MatchingEngine::cancel_order(uint64_t order_id) {
+    LOB_STAGE_MARK(stage_timings);
+    bool cancelled = order_book.cancel_order(order_id) || stop_book.cancel(order_id);
+    LOB_STAGE_LAP(stage_timings, Stage::CANCEL);
+    return cancelled;
+}
+
+size_t MatchingEngine::mass_cancel(const MassCancel& filter) {
+    LOB_STAGE_MARK(stage_timings);
+    size_t cancelled = order_book.mass_cancel(filter) + stop_book.cancel_matching(filter);
+    LOB_STAGE_LAP(stage_timings, Stage::CANCEL);
+    return cancelled;
+}
+
+bool MatchingEngine::modify_order(uint64_t order_id, int new_quantity, Price new_price) {
+    return modify_order(order_id, new_quantity, new_price, [](const Fill&) {});
+}
+
+bool MatchingEngine::modify_order(uint64_t order_id, int new_quantity, Price new_price, std::vector<Fill>& fills,
+                                  uint64_t timestamp) {
+    return modify_order(order_id, new_quantity, new_price, [&fills](const Fill& fill) { fills.push_back(fill); },
+                        timestamp);
 }
 
 Fill MatchingEngine::create_fill(const Order& aggressive_order, const Order& passive_order,
-                                double fill_price, int fill_quantity) {
+                                double fill_price, int fill_quantity, uint64_t timestamp) {
     Fill fill;
     fill.buy_order_id = aggressive_order.is_buy() ? aggressive_order.order_id : passive_order.order_id;
     fill.sell_order_id = aggressive_order.is_sell() ? aggressive_order.order_id : passive_order.order_id;
     fill.price = fill_price;
     fill.quantity = fill_quantity;
-    fill.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
+    fill.timestamp = timestamp;
     
     return fill;
 }
@@ -258,9 +197,14 @@ void MatchingEngine::notify_fill(const Fill& fill) {
     }
 }
 
-void MatchingEngine::update_statistics(const Fill& fill) {
-    fill_count++;
-    total_traded_volume += fill.price * fill.quantity;
+void MatchingEngine::update_statistics(const TradeTotals& totals) {
+    fill_count += totals.fills;
+    traded_notional += totals.notional;
+}
+
+bool MatchingEngine::is_valid(const Order& order) const {
+    // Orders built through the unvalidated factories are checked here instead
+    return order.quantity > 0 && (order.is_market() || order.price > 0);
 }
 
 bool MatchingEngine::can_match(const Order& buy_order, const Order& sell_order) const {
@@ -270,5 +214,5 @@ bool MatchingEngine::can_match(const Order& buy_order, const Order& sell_order)
 double MatchingEngine::determine_fill_price(const Order& /* aggressive_order */, 
                                            const Order& passive_order) const {
     // Price-time priority: passive order price takes precedence
-    return passive_order.price;
+    return order_book.to_price(passive_order.price);
 }
@@ -1,9 +1,16 @@
 #pragma once
 
+#include "command.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
+#include "stop_book.hpp"
+#include "utils/logger.hpp"
+#include "utils/stage_timer.hpp"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <functional>
+#include <limits>
 
 struct Fill {
     uint64_t buy_order_id;
@@ -17,42 +24,518 @@ struct Fill {
 
 using FillCallback = std::function<void(const Fill&)>;
 
+// Outcome of a call auction at its equilibrium price
+struct AuctionResult {
+    bool crossed = false;       // false when no bid reaches the best ask
+    Price price = 0;            // ticks
+    int64_t volume = 0;         // executable quantity at `price`
+    int64_t imbalance = 0;      // buy minus sell quantity left unmatched at `price`
+    size_t fills = 0;           // set by uncross()
+};
+
 class MatchingEngine {
 public:
-    explicit MatchingEngine(FillCallback callback = nullptr);
+    explicit MatchingEngine(FillCallback callback = nullptr, double tick_size = DEFAULT_TICK_SIZE,
+                            size_t order_capacity = OrderBook::DEFAULT_ORDER_CAPACITY);
     
     // Core matching functionality
     std::vector<Fill> process_order(const Order& order);
     
+    // Appends fills to a caller-owned buffer, which can be reused across calls
+    size_t process_order(const Order& order, std::vector<Fill>& fills);
+    
+    // Hands each fill to `sink` inline as it is generated; returns the fill count
+    template <typename FillSink>
+    size_t process_order(const Order& order, FillSink&& sink);
+    
+    // Applies one order-flow command; returns the number of fills it generated
+    template <typename FillSink>
+    size_t execute(const Command& command, FillSink&& sink);
+    
+    // Applies `count` commands in order with the same outcome as calling execute
+    // on each, but logs once and folds statistics in once per batch
+    template <typename FillSink>
+    size_t process_batch(const Command* commands, size_t count, FillSink&& sink);
+    size_t process_batch(const Command* commands, size_t count, std::vector<Fill>& fills);
+    
+    // Stop (market) or stop-limit order: `order` waits in the stop book until a
+    // trade prints at or above `trigger_price` (buys) or at or below it (sells),
+    // then enters like any other order. Fires at once if the last trade already
+    // reached the trigger. Returns the fills this call generated.
+    size_t submit_stop(const Order& order, Price trigger_price, std::vector<Fill>& fills);
+    template <typename FillSink>
+    size_t submit_stop(const Order& order, Price trigger_price, FillSink&& sink);
+    
+    // Call auction: limit orders rest without matching until uncross(), market
+    // orders are rejected. Cancels and modifies work as usual.
+    void begin_auction();
+    bool in_auction() const { return auction_phase; }
+    
+    // Equilibrium price and volume the book would uncross at right now.
+    // Maximum executable volume first, then the smallest imbalance, then market
+    // pressure (buy surplus takes the highest candidate, sell surplus the lowest),
+    // then the candidate nearest `reference_price` (the middle of the candidates
+    // when none is given)
+    AuctionResult indicative_auction(Price reference_price = 0) const;
+    
+    // Executes every auction fill at the single equilibrium price, in price-time
+    // priority on both sides, and returns to continuous matching
+    template <typename FillSink>
+    AuctionResult uncross(FillSink&& sink, Price reference_price = 0);
+    AuctionResult uncross(std::vector<Fill>& fills, Price reference_price = 0);
+    
     // Order book access
     const OrderBook& get_order_book() const { return order_book; }
     OrderBook& get_order_book() { return order_book; }
+    const StopBook& get_stop_book() const { return stop_book; }
+    StopBook& get_stop_book() { return stop_book; }
     
-    // Cancel and modify orders
+    // Cancel also withdraws pending stops
     bool cancel_order(uint64_t order_id);
-    bool modify_order(uint64_t order_id, int new_quantity);
+    
+    // Kill switch: withdraws every resting order and pending stop `filter`
+    // selects in one bulk pass and returns how many went
+    size_t mass_cancel(const MassCancel& filter);
+    
+    // Amends a resting order. A smaller quantity at the same price is applied in
+    // place and keeps queue priority. A larger quantity or a new price
+    // (`new_price` in ticks, 0 keeps the current one) is a cancel/replace: the
+    // order re-enters behind everything already resting, stamped with
+    // `timestamp` (0 keeps the old one), and may trade straight away.
+    bool modify_order(uint64_t order_id, int new_quantity, Price new_price = 0);
+    bool modify_order(uint64_t order_id, int new_quantity, Price new_price, std::vector<Fill>& fills,
+                      uint64_t timestamp = 0);
+    template <typename FillSink>
+    bool modify_order(uint64_t order_id, int new_quantity, Price new_price, FillSink&& sink, uint64_t timestamp = 0);
     
     // Statistics
     size_t total_fills() const { return fill_count; }
-    double total_volume() const { return total_traded_volume; }
+    double total_volume() const { return static_cast<double>(traded_notional) * order_book.tick_size(); }
+    Price last_trade_price() const { return last_price; }     // ticks, 0 before the first trade
     
+    // Reinstates counters saved in a snapshot
+    void restore_statistics(size_t fills, double volume, Price last_trade = 0) {
+        fill_count = fills;
+        traded_notional = std::llround(volume / order_book.tick_size());
+        last_price = last_trade;
+    }
+
+#if LOB_STAGE_TIMING
+    // Per-stage latency of the matching path (build with STAGE_TIMING=1)
+    const StageStats& stage_stats() const { return stage_timings; }
+    void reset_stage_stats() { stage_timings.reset(); }
+#endif
+
 private:
+    // Fill count and notional (price ticks x quantity) gathered while matching,
+    // added to the engine totals once per call or batch
+    struct TradeTotals {
+        size_t fills = 0;
+        int64_t notional = 0;
+    };
+    
     OrderBook order_book;
+    StopBook stop_book;
     FillCallback fill_callback;
     size_t fill_count = 0;
-    double total_traded_volume = 0.0;
-    
+    int64_t traded_notional = 0;
+    Price last_price = 0;
+    bool auction_phase = false;
+#if LOB_STAGE_TIMING
+    StageStats stage_timings;
+#endif
+
     // Matching algorithms
-    std::vector<Fill> match_limit_order(const Order& order);
-    std::vector<Fill> match_market_order(const Order& order);
+    template <typename FillSink>
+    void match_order(const Order& order, FillSink& sink, TradeTotals& totals);
+    template <typename FillSink>
+    void match_limit_order(const Order& order, FillSink& sink, TradeTotals& totals);
+    template <typename FillSink>
+    void match_market_order(const Order& order, FillSink& sink, TradeTotals& totals);
+    template <typename FillSink>
+    void match_against_book(Order& remaining_order, Price limit_price, FillSink& sink, TradeTotals& totals);
+    template <typename FillSink>
+    bool amend_order(uint64_t order_id, int new_quantity, Price new_price, uint64_t timestamp, FillSink& sink,
+                     TradeTotals& totals);
+    template <typename FillSink>
+    AuctionResult uncross_book(Price reference_price, FillSink& sink, TradeTotals& totals);
+    
+    // Stop handling
+    template <typename FillSink>
+    void place_stop(const Order& order, Price trigger_price, FillSink& sink, TradeTotals& totals);
+    template <typename FillSink>
+    void activate_stops(FillSink& sink, TradeTotals& totals);
     
     // Helper methods
-    Fill create_fill(const Order& aggressive_order, const Order& passive_order, 
-                    double fill_price, int fill_quantity);
+    Fill create_fill(const Order& aggressive_order, const Order& passive_order,
+                     double fill_price, int fill_quantity, uint64_t timestamp);
     void notify_fill(const Fill& fill);
-    void update_statistics(const Fill& fill);
+    void update_statistics(const TradeTotals& totals);
     
     // Price-time priority matching
+    bool is_valid(const Order& order) const;
+    
+    // Worst contra price the order may trade at; market orders walk the book without one
+    static Price limit_price(const Order& order) {
+        if (order.is_limit()) {
+            return order.price;
+        }
+        return order.is_buy() ? std::numeric_limits<Price>::max() : std::numeric_limits<Price>::min();
+    }
     bool can_match(const Order& buy_order, const Order& sell_order) const;
     double determine_fill_price(const Order& aggressive_order, const Order& passive_order) const;
 };
+
+template <typename FillSink>
+size_t MatchingEngine::process_order(const Order& order, FillSink&& sink) {
+    LOG_INFO("Processing order: ID={} {} {} qty {} @ {}", order.order_id, side_to_string(order.side),
+             order_type_to_string(order.type), order.quantity, order_book.to_price(order.price));
+    
+    TradeTotals totals;
+    match_order(order, sink, totals);
+    activate_stops(sink, totals);
+    update_statistics(totals);
+    
+    LOG_INFO("Generated {} fills", totals.fills);
+    return totals.fills;
+}
+
+template <typename FillSink>
+size_t MatchingEngine::submit_stop(const Order& order, Price trigger_price, FillSink&& sink) {
+    LOG_INFO("Processing stop order: ID={} {} {} qty {} trigger {}", order.order_id, side_to_string(order.side),
+             order_type_to_string(order.type), order.quantity, order_book.to_price(trigger_price));
+    
+    TradeTotals totals;
+    place_stop(order, trigger_price, sink, totals);
+    update_statistics(totals);
+    return totals.fills;
+}
+
+template <typename FillSink>
+bool MatchingEngine::modify_order(uint64_t order_id, int new_quantity, Price new_price, FillSink&& sink,
+                                  uint64_t timestamp) {
+    TradeTotals totals;
+    bool modified = amend_order(order_id, new_quantity, new_price, timestamp, sink, totals);
+    activate_stops(sink, totals);
+    update_statistics(totals);
+    return modified;
+}
+
+template <typename FillSink>
+size_t MatchingEngine::execute(const Command& command, FillSink&& sink) {
+    switch (command.type) {
+        case CommandType::ADD:
+            return process_order(command.order, sink);
+        case CommandType::CANCEL:
+            cancel_order(command.order.order_id);
+            return 0;
+        case CommandType::MODIFY: {
+            size_t fills_before = fill_count;
+            modify_order(command.order.order_id, command.order.quantity, command.order.price, sink,
+                         command.order.timestamp);
+            return fill_count - fills_before;
+        }
+        case CommandType::ADD_STOP:
+            return submit_stop(command.order, command.trigger_price, sink);
+        case CommandType::MASS_CANCEL:
+            mass_cancel(command.mass_cancel_filter());
+            return 0;
+        case CommandType::BEGIN_AUCTION:
+            begin_auction();
+            return 0;
+        case CommandType::UNCROSS: {
+            size_t fills_before = fill_count;
+            uncross(sink, command.order.price);
+            return fill_count - fills_before;
+        }
+    }
+    return 0;
+}
+
+template <typename FillSink>
+size_t MatchingEngine::process_batch(const Command* commands, size_t count, FillSink&& sink) {
+    LOG_INFO("Processing batch of {} commands", count);
+    
+    TradeTotals totals;
+    for (const Command* command = commands; command != commands + count; ++command) {
+        switch (command->type) {
+            case CommandType::ADD:
+                match_order(command->order, sink, totals);
+                activate_stops(sink, totals);
+                break;
+            case CommandType::CANCEL:
+                cancel_order(command->order.order_id);
+                break;
+            case CommandType::MODIFY:
+                amend_order(command->order.order_id, command->order.quantity, command->order.price,
+                            command->order.timestamp, sink, totals);
+                activate_stops(sink, totals);
+                break;
+            case CommandType::ADD_STOP:
+                place_stop(command->order, command->trigger_price, sink, totals);
+                break;
+            case CommandType::MASS_CANCEL:
+                mass_cancel(command->mass_cancel_filter());
+                break;
+            case CommandType::BEGIN_AUCTION:
+                begin_auction();
+                break;
+            case CommandType::UNCROSS:
+                uncross_book(command->order.price, sink, totals);
+                break;
+        }
+    }
+    update_statistics(totals);
+    
+    LOG_INFO("Batch generated {} fills", totals.fills);
+    return totals.fills;
+}
+
+template <typename FillSink>
+void MatchingEngine::match_order(const Order& order, FillSink& sink, TradeTotals& totals) {
+    LOB_STAGE_MARK(stage_timings);
+    bool valid = is_valid(order);
+    LOB_STAGE_LAP(stage_timings, Stage::VALIDATE);
+    if (!valid) {
+        LOG_ERROR("Rejected invalid order {}", order.order_id);
+        return;
+    }
+    // A pending stop's id would make the stop a duplicate once it triggers;
+    // released stops are popped before they get here
+    if (!stop_book.empty() && stop_book.contains(order.order_id)) {
+        LOG_ERROR("Rejected order {}: id belongs to a pending stop", order.order_id);
+        return;
+    }
+    
+    if (auction_phase) {
+        if (order.is_market()) {
+            LOG_ERROR("Rejected market order {} during auction", order.order_id);
+        } else if (!order.may_rest()) {
+            LOG_ERROR("Rejected {} order {} during auction",
+                      time_in_force_to_string(order.time_in_force), order.order_id);
+        } else {
+            order_book.add_order(order);
+            LOB_STAGE_LAP(stage_timings, Stage::INSERT);
+        }
+        return;
+    }
+    
+    // Fill-or-kill is decided from the level totals before anything is touched,
+    // so a killed order costs a short read-only walk and no rollback
+    if (order.is_fill_or_kill() &&
+        order_book.available_quantity(!order.is_buy(), limit_price(order), order.quantity) < order.quantity) {
+        LOB_STAGE_LAP(stage_timings, Stage::MATCH);
+        LOG_INFO("Killed FOK order {}: {} not available", order.order_id, order.quantity);
+        return;
+    }
+    
+    if (order.is_limit()) {
+        match_limit_order(order, sink, totals);
+    } else {
+        match_market_order(order, sink, totals);
+    }
+}
+
+template <typename FillSink>
+AuctionResult MatchingEngine::uncross(FillSink&& sink, Price reference_price) {
+    TradeTotals totals;
+    AuctionResult result = uncross_book(reference_price, sink, totals);
+    update_statistics(totals);
+    return result;
+}
+
+template <typename FillSink>
+AuctionResult MatchingEngine::uncross_book(Price reference_price, FillSink& sink, TradeTotals& totals) {
+    AuctionResult result = indicative_auction(reference_price);
+    auction_phase = false;
+    if (result.volume == 0) {
+        LOG_INFO("Auction closed without a cross");
+        return result;
+    }
+    
+    // Every bid at or above the price and every ask at or below it is eligible,
+    // and each side holds at least `volume` of them, so the fronts always qualify
+    size_t fills_before = totals.fills;
+    double fill_price = order_book.to_price(result.price);
+    uint64_t timestamp = Order::get_current_timestamp();
+    int64_t remaining = result.volume;
+    while (remaining > 0) {
+        const Order& buy_order = order_book.front_order(true);
+        const Order& sell_order = order_book.front_order(false);
+        int fill_quantity = static_cast<int>(std::min<int64_t>(
+            remaining, std::min(buy_order.quantity, sell_order.quantity)));
+        Fill fill = create_fill(buy_order, sell_order, fill_price, fill_quantity, timestamp);
+        totals.notional += static_cast<int64_t>(result.price) * fill_quantity;
+        totals.fills++;
+        
+        order_book.consume_front(true, fill_quantity);
+        order_book.consume_front(false, fill_quantity);
+        remaining -= fill_quantity;
+        
+        notify_fill(fill);
+        sink(fill);
+    }
+    last_price = result.price;
+    result.fills = totals.fills - fills_before;
+    activate_stops(sink, totals);
+    
+    LOG_INFO("Auction uncrossed {} at {} in {} fills", result.volume, fill_price, result.fills);
+    return result;
+}
+
+template <typename FillSink>
+void MatchingEngine::match_limit_order(const Order& order, FillSink& sink, TradeTotals& totals) {
+    Order remaining_order = order;
+    
+    match_against_book(remaining_order, order.price, sink, totals);
+    
+    // IOC and FOK remainders are dropped instead of resting
+    if (remaining_order.quantity > 0 && !order.may_rest()) {
+        LOG_DEBUG("Dropping unfilled {} quantity {} of order {}",
+                  time_in_force_to_string(order.time_in_force), remaining_order.quantity, order.order_id);
+    } else if (remaining_order.quantity > 0) {
+        LOG_DEBUG("Adding remaining quantity {} to order book", remaining_order.quantity);
+        order_book.add_order(remaining_order);
+        LOB_STAGE_LAP(stage_timings, Stage::INSERT);
+    }
+}
+
+template <typename FillSink>
+void MatchingEngine::match_market_order(const Order& order, FillSink& sink, TradeTotals& totals) {
+    Order remaining_order = order;
+    
+    match_against_book(remaining_order, limit_price(order), sink, totals);
+    
+    // Market orders that can't be filled are rejected
+    if (remaining_order.quantity > 0) {
+        LOG_ERROR("Market order {} partially rejected - remaining quantity: {}",
+                  order.order_id, remaining_order.quantity);
+    }
+}
+
+template <typename FillSink>
+void MatchingEngine::match_against_book(Order& remaining_order, Price limit_price, FillSink& sink,
+                                        TradeTotals& totals) {
+    bool contra_is_buy = !remaining_order.is_buy();
+    uint64_t timestamp = 0;     // every fill of one incoming order shares a timestamp
+    
+    while (remaining_order.quantity > 0 && order_book.has_orders(contra_is_buy)) {
+        Price best_price = order_book.best_price(contra_is_buy);
+        
+        // Check if we can match at the best contra level
+        if (contra_is_buy ? limit_price > best_price : limit_price < best_price) {
+            break; // No more matching possible
+        }
+        
+        // Match against the oldest order at the best level (FIFO)
+        const Order& passive_order = order_book.front_order(contra_is_buy);
+        
+        int fill_quantity = std::min(remaining_order.quantity, passive_order.quantity);
+        double fill_price = determine_fill_price(remaining_order, passive_order);
+        if (timestamp == 0) {
+            timestamp = Order::get_current_timestamp();
+        }
+        Fill fill = create_fill(remaining_order, passive_order, fill_price, fill_quantity, timestamp);
+        totals.notional += static_cast<int64_t>(best_price) * fill_quantity;
+        totals.fills++;
+        last_price = best_price;
+        
+        // Update quantities; the book drops filled orders and empty levels
+        remaining_order.quantity -= fill_quantity;
+        order_book.consume_front(contra_is_buy, fill_quantity);
+        
+        // Deliver the fill in the same pass that produced it
+        LOB_STAGE_BEGIN(notify_start);
+        notify_fill(fill);
+        sink(fill);
+        LOB_STAGE_END(stage_timings, Stage::NOTIFY, notify_start);
+    }
+    LOB_STAGE_LAP(stage_timings, Stage::MATCH);
+}
+
+template <typename FillSink>
+bool MatchingEngine::amend_order(uint64_t order_id, int new_quantity, Price new_price, uint64_t timestamp,
+                                 FillSink& sink, TradeTotals& totals) {
+    LOB_STAGE_MARK(stage_timings);
+    const Order* resting = order_book.find_order(order_id);
+    if (!resting) {
+        LOB_STAGE_LAP(stage_timings, Stage::MODIFY);
+        LOG_DEBUG("Order {} not found for modification", order_id);
+        return false;
+    }
+    if (new_quantity <= 0 || new_price < 0) {
+        LOB_STAGE_LAP(stage_timings, Stage::MODIFY);
+        LOG_ERROR("Rejected amendment of order {} to qty {} @ {}", order_id, new_quantity,
+                  order_book.to_price(new_price));
+        return false;
+    }
+    
+    // Shrinking in place touches only the level totals
+    if ((new_price == 0 || new_price == resting->price) && new_quantity <= resting->quantity) {
+        bool reduced = order_book.reduce_order(order_id, new_quantity);
+        LOB_STAGE_LAP(stage_timings, Stage::MODIFY);
+        return reduced;
+    }
+    
+    // Anything else loses priority: pull the order, then submit the new terms
+    // like a fresh order so a price that now crosses trades immediately
+    Order replacement = *resting;
+    replacement.quantity = new_quantity;
+    if (new_price != 0) {
+        replacement.price = new_price;
+    }
+    if (timestamp != 0) {
+        replacement.timestamp = timestamp;
+    }
+    
+    // Checked before the original is pulled, so a rejected replace leaves it untouched
+    if (!order_book.fits_ladder(replacement.is_buy(), replacement.price)) {
+        LOB_STAGE_LAP(stage_timings, Stage::MODIFY);
+        LOG_ERROR("Rejected amendment of order {}: price {} is outside the price ladder range", order_id,
+                  order_book.to_price(replacement.price));
+        return false;
+    }
+    if (stop_book.contains(order_id)) {
+        LOB_STAGE_LAP(stage_timings, Stage::MODIFY);
+        LOG_ERROR("Rejected amendment of order {}: id belongs to a pending stop", order_id);
+        return false;
+    }
+    order_book.cancel_order(order_id);
+    LOB_STAGE_LAP(stage_timings, Stage::MODIFY);
+    
+    LOG_INFO("Replacing order {} with qty {} @ {}", order_id, new_quantity, order_book.to_price(replacement.price));
+    match_order(replacement, sink, totals);
+    return true;
+}
+
+template <typename FillSink>
+void MatchingEngine::place_stop(const Order& order, Price trigger_price, FillSink& sink, TradeTotals& totals) {
+    if (!is_valid(order) || trigger_price <= 0) {
+        LOG_ERROR("Rejected invalid stop order {}", order.order_id);
+        return;
+    }
+    // A resting order's id would make the stop a duplicate once it triggers
+    if (order_book.has_order(order.order_id)) {
+        LOG_ERROR("Rejected stop order {}: id is already resting", order.order_id);
+        return;
+    }
+    if (!stop_book.add(order, trigger_price)) {
+        return;
+    }
+    activate_stops(sink, totals);
+}
+
+template <typename FillSink>
+void MatchingEngine::activate_stops(FillSink& sink, TradeTotals& totals) {
+    // Stops wait out an auction; they fire on the uncross price instead
+    if (stop_book.empty() || auction_phase || last_price == 0) {
+        return;
+    }
+    
+    // Each released order may print a new last price and release further stops
+    Order released;
+    while (stop_book.pop_triggered(last_price, released)) {
+        LOG_DEBUG("Stop order {} triggered at {}", released.order_id, order_book.to_price(last_price));
+        match_order(released, sink, totals);
+    }
+}
@@ -0,0 +1,228 @@
+#include "monte_carlo.hpp"
+#include "matching_engine.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace {
+
+// The whole path on the calling thread. Logging must already be silenced:
+// workers run this concurrently and must not touch the shared log level.
+PathResult simulate_path(uint64_t seed, const OrderFlowParams& flow, size_t order_count) {
+    MatchingEngine engine(nullptr, flow.tick_size, std::max<size_t>(order_count, 1));
+    Price mid = price_to_ticks(flow.mid_price, flow.tick_size);
+    Price range = price_to_ticks(flow.price_range, flow.tick_size);
+
+    // Integer distributions over ticks keep every draw exact, so a seed
+    // reproduces its path bit for bit
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<Price> price_dist(std::max<Price>(mid - range, 1), std::max<Price>(mid + range, 1));
+    std::uniform_int_distribution<int> quantity_dist(flow.min_quantity, flow.max_quantity);
+    std::bernoulli_distribution buy_dist(0.5);
+    std::bernoulli_distribution market_dist(flow.market_ratio);
+    std::bernoulli_distribution cancel_dist(flow.cancel_ratio);
+
+    PathResult result;
+    result.seed = seed;
+    auto on_fill = [&result](const Fill& fill) { result.volume += fill.quantity; };
+
+    uint64_t next_id = 1;
+    for (size_t i = 0; i < order_count; ++i) {
+        if (next_id > 1 && cancel_dist(gen)) {
+            // Earlier ids that already filled or were cancelled simply miss
+            uint64_t order_id = std::uniform_int_distribution<uint64_t>(1, next_id - 1)(gen);
+            engine.execute(Command::cancel(i + 1, order_id), on_fill);
+            continue;
+        }
+
+        Side side = buy_dist(gen) ? Side::BUY : Side::SELL;
+        Order order = market_dist(gen)
+            ? Order::market_order(next_id, quantity_dist(gen), side)
+            : Order::limit_order(next_id, price_dist(gen), quantity_dist(gen), side);
+        next_id++;
+        engine.execute(Command::add(i + 1, order), on_fill);
+    }
+
+    const OrderBook& book = engine.get_order_book();
+    result.fills = engine.total_fills();
+    if (book.has_orders(true) && book.has_orders(false)) {
+        result.spread = book.best_price(false) - book.best_price(true);
+    }
+    result.bid_depth = book.side_quantity(true);
+    result.ask_depth = book.side_quantity(false);
+    result.resting_orders = book.total_orders();
+    return result;
+}
+
+} // namespace
+
+Distribution Distribution::of(std::vector<double> values) {
+    Distribution dist;
+    dist.count = values.size();
+    if (values.empty()) {
+        return dist;
+    }
+
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    dist.mean = sum / values.size();
+    double squares = 0.0;
+    for (double value : values) {
+        squares += (value - dist.mean) * (value - dist.mean);
+    }
+    dist.stddev = std::sqrt(squares / values.size());
+
+    auto rank = [&values](double p) {
+        size_t index = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[std::min(std::max<size_t>(index, 1), values.size()) - 1];
+    };
+    dist.min = values.front();
+    dist.p5 = rank(0.05);
+    dist.p50 = rank(0.50);
+    dist.p95 = rank(0.95);
+    dist.max = values.back();
+    return dist;
+}
+
+MonteCarloRunner::MonteCarloRunner(const MonteCarloConfig& config) : config(config) {}
+
+uint64_t MonteCarloRunner::path_seed(uint64_t base_seed, size_t index) {
+    uint64_t z = base_seed + (static_cast<uint64_t>(index) + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+PathResult MonteCarloRunner::run_path(uint64_t seed, const OrderFlowParams& flow, size_t order_count) {
+    LogLevel saved_level = Logger::current_level;
+    Logger::current_level = LogLevel::LOG_OFF;
+    PathResult result = simulate_path(seed, flow, order_count);
+    Logger::current_level = saved_level;
+    return result;
+}
+
+MonteCarloReport MonteCarloRunner::run() const {
+    size_t threads = config.thread_count;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, std::max<size_t>(config.run_count, 1));
+
+    MonteCarloReport report;
+    report.thread_count = threads;
+    report.orders_per_run = config.orders_per_run;
+    report.paths.resize(config.run_count);
+    LOG_INFO("Monte Carlo: {} runs of {} orders on {} threads", config.run_count, config.orders_per_run, threads);
+
+    // Workers claim run indices one at a time, so uneven paths balance out,
+    // and write only their own slots. Logging is silenced once up front.
+    std::atomic<size_t> next_run{0};
+    auto work = [this, &report, &next_run]() {
+        for (size_t run = next_run.fetch_add(1, std::memory_order_relaxed); run < config.run_count;
+             run = next_run.fetch_add(1, std::memory_order_relaxed)) {
+            report.paths[run] = simulate_path(path_seed(config.base_seed, run), config.flow, config.orders_per_run);
+        }
+    };
+
+    LogLevel saved_level = Logger::current_level;
+    Logger::current_level = LogLevel::LOG_OFF;
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        pool.emplace_back(work);
+    }
+    for (auto& worker : pool) {
+        worker.join();
+    }
+    auto end_time = std::chrono::steady_clock::now();
+
+    Logger::current_level = saved_level;
+    report.elapsed_seconds = std::chrono::duration<double>(end_time - start_time).count();
+
+    std::vector<double> fills, volume, spread, bid_depth, ask_depth;
+    for (const PathResult& path : report.paths) {
+        fills.push_back(static_cast<double>(path.fills));
+        volume.push_back(static_cast<double>(path.volume));
+        bid_depth.push_back(static_cast<double>(path.bid_depth));
+        ask_depth.push_back(static_cast<double>(path.ask_depth));
+        if (path.spread >= 0) {
+            spread.push_back(static_cast<double>(path.spread));
+        } else {
+            report.one_sided_paths++;
+        }
+    }
+    report.fills = Distribution::of(std::move(fills));
+    report.volume = Distribution::of(std::move(volume));
+    report.spread = Distribution::of(std::move(spread));
+    report.bid_depth = Distribution::of(std::move(bid_depth));
+    report.ask_depth = Distribution::of(std::move(ask_depth));
+    return report;
+}
+
+void MonteCarloRunner::print_report(const MonteCarloReport& report, double tick_size) {
+    double seconds = report.elapsed_seconds > 0.0 ? report.elapsed_seconds : 1e-9;
+    size_t runs = report.paths.size();
+
+    std::cout << "\n=== MONTE CARLO ===" << std::endl;
+    std::cout << "Runs: " << runs << " x " << report.orders_per_run << " orders on "
+              << report.thread_count << " threads in " << std::fixed << std::setprecision(3)
+              << seconds << " s" << std::endl;
+    std::cout << std::setprecision(0);
+    std::cout << "Runs/sec: " << runs / seconds << ", orders/sec: "
+              << runs * report.orders_per_run / seconds << std::endl;
+
+    std::cout << "\n" << std::left << std::setw(16) << "metric" << std::right;
+    for (const char* column : {"mean", "stddev", "min", "p5", "p50", "p95", "max"}) {
+        std::cout << std::setw(12) << column;
+    }
+    std::cout << std::endl;
+
+    auto row = [](const char* name, const Distribution& dist, double scale, int precision) {
+        std::cout << std::left << std::setw(16) << name << std::right << std::setprecision(precision);
+        for (double value : {dist.mean, dist.stddev, dist.min, dist.p5, dist.p50, dist.p95, dist.max}) {
+            std::cout << std::setw(12) << value * scale;
+        }
+        std::cout << std::endl;
+    };
+    row("fills", report.fills, 1.0, 1);
+    row("volume", report.volume, 1.0, 1);
+    row("spread", report.spread, tick_size, 4);
+    row("bid depth", report.bid_depth, 1.0, 1);
+    row("ask depth", report.ask_depth, 1.0, 1);
+    if (report.one_sided_paths) {
+        std::cout << report.one_sided_paths << " runs ended with an empty side and have no spread" << std::endl;
+    }
+
+    // Seeds of the extremes, for replaying them with --path
+    if (runs) {
+        auto by_fills = [](const PathResult& a, const PathResult& b) { return a.fills < b.fills; };
+        auto fewest = std::min_element(report.paths.begin(), report.paths.end(), by_fills);
+        auto most = std::max_element(report.paths.begin(), report.paths.end(), by_fills);
+        std::cout << "\nFewest fills: run " << fewest - report.paths.begin() << ", seed " << fewest->seed << std::endl;
+        std::cout << "Most fills:   run " << most - report.paths.begin() << ", seed " << most->seed << std::endl;
+    }
+    std::cout << "===================\n" << std::endl;
+}
+
+void MonteCarloRunner::print_path(const PathResult& path, double tick_size) {
+    std::cout << "\n=== PATH " << path.seed << " ===" << std::endl;
+    std::cout << "Fills: " << path.fills << ", volume: " << path.volume << std::endl;
+    if (path.spread >= 0) {
+        std::cout << "Spread: " << std::fixed << std::setprecision(4) << path.spread * tick_size << std::endl;
+    } else {
+        std::cout << "Spread: none (one side empty)" << std::endl;
+    }
+    std::cout << "Final book: " << path.resting_orders << " orders, " << path.bid_depth << " bid and "
+              << path.ask_depth << " ask quantity" << std::endl;
+}
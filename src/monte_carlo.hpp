@@ -0,0 +1,87 @@
+#pragma once
+
+#include "price.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Random order flow for one simulated path. Limit prices are uniform in ticks
+// over [mid_price - price_range, mid_price + price_range].
+struct OrderFlowParams {
+    double tick_size = DEFAULT_TICK_SIZE;
+    double mid_price = 100.0;
+    double price_range = 5.0;
+    int min_quantity = 10;
+    int max_quantity = 1000;
+    double market_ratio = 0.1;      // share of adds that are market orders
+    double cancel_ratio = 0.0;      // share of events that cancel an earlier order id
+};
+
+struct MonteCarloConfig {
+    size_t run_count = 1000;
+    size_t orders_per_run = 10000;
+    uint64_t base_seed = 42;
+    size_t thread_count = 0;        // 0 = one per hardware thread
+    OrderFlowParams flow;
+};
+
+// Final state of one path. spread is in ticks and -1 when either side is empty.
+struct PathResult {
+    uint64_t seed = 0;
+    uint64_t fills = 0;
+    int64_t volume = 0;             // traded quantity
+    Price spread = -1;
+    int64_t bid_depth = 0;          // resting quantity per side
+    int64_t ask_depth = 0;
+    size_t resting_orders = 0;
+};
+
+// Summary of one metric across paths; percentiles are nearest-rank
+struct Distribution {
+    size_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double p5 = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+
+    static Distribution of(std::vector<double> values);
+};
+
+struct MonteCarloReport {
+    size_t thread_count = 0;
+    size_t orders_per_run = 0;
+    double elapsed_seconds = 0.0;
+    std::vector<PathResult> paths;  // indexed by run, independent of thread count
+    Distribution fills;
+    Distribution volume;
+    Distribution spread;            // ticks, two-sided paths only
+    Distribution bid_depth;
+    Distribution ask_depth;
+    size_t one_sided_paths = 0;     // ended with an empty side, so no spread
+};
+
+// Runs independent simulated paths on a pool of worker threads. Each path gets
+// its own engine and generator, seeded only from base_seed and its run index,
+// so any path can be reproduced on its own with run_path(path_seed(...)).
+class MonteCarloRunner {
+public:
+    explicit MonteCarloRunner(const MonteCarloConfig& config = MonteCarloConfig());
+
+    MonteCarloReport run() const;
+
+    // Seed of run `index`: splitmix64 of base_seed + index, so neighbouring
+    // runs do not get correlated generator states
+    static uint64_t path_seed(uint64_t base_seed, size_t index);
+
+    // One path from `seed` through a fresh engine, on the calling thread
+    static PathResult run_path(uint64_t seed, const OrderFlowParams& flow, size_t order_count);
+
+    static void print_report(const MonteCarloReport& report, double tick_size);
+    static void print_path(const PathResult& path, double tick_size);
+
+private:
+    MonteCarloConfig config;
+};
@@ -2,16 +2,26 @@
 #include <sstream>
 #include <stdexcept>
 
-Order::Order(uint64_t id, double p, int qty, const std::string& s, const std::string& t)
-    : order_id(id), price(p), quantity(qty), side(s), type(t), timestamp(get_current_timestamp()) {
+Order::Order(uint64_t id, double p, int qty, const std::string& s, const std::string& t,
+             double tick_size)
+    : order_id(id), timestamp(get_current_timestamp()), price(0), quantity(qty), symbol_id(0),
+      side(Side::BUY), type(OrderType::LIMIT), time_in_force(TimeInForce::GTC), owner_id(0) {
     
     // Validate side
-    if (side != "BUY" && side != "SELL") {
+    if (s == "BUY") {
+        side = Side::BUY;
+    } else if (s == "SELL") {
+        side = Side::SELL;
+    } else {
         throw std::invalid_argument("Order side must be 'BUY' or 'SELL'");
     }
     
     // Validate type
-    if (type != "LIMIT" && type != "MARKET") {
+    if (t == "LIMIT") {
+        type = OrderType::LIMIT;
+    } else if (t == "MARKET") {
+        type = OrderType::MARKET;
+    } else {
         throw std::invalid_argument("Order type must be 'LIMIT' or 'MARKET'");
     }
     
@@ -21,53 +31,70 @@ Order::Order(uint64_t id, double p, int qty, const std::string& s, const std::st
     }
     
     // Validate price for limit orders
-    if (type == "LIMIT" && price <= 0.0) {
-        throw std::invalid_argument("Limit order price must be positive");
+    if (type == OrderType::LIMIT) {
+        if (!try_price_to_ticks(p, tick_size, price)) {
+            throw std::invalid_argument("Limit order price is out of range");
+        }
+        if (p <= 0.0 || price <= 0) {
+            throw std::invalid_argument("Limit order price must be positive");
+        }
     }
 }
 
-Order Order::create_limit_order(uint64_t id, double price, int quantity, const std::string& side) {
-    return Order(id, price, quantity, side, "LIMIT");
+Order Order::create_limit_order(uint64_t id, double price, int quantity, const std::string& side,
+                                double tick_size) {
+    return Order(id, price, quantity, side, "LIMIT", tick_size);
 }
 
 Order Order::create_market_order(uint64_t id, int quantity, const std::string& side) {
     return Order(id, 0.0, quantity, side, "MARKET");
 }
 
-bool Order::is_buy() const {
-    return side == "BUY";
+Order Order::limit_order(uint64_t id, Price price, int quantity, Side side, uint16_t symbol_id) {
+    Order order;
+    order.order_id = id;
+    order.timestamp = get_current_timestamp();
+    order.price = price;
+    order.quantity = quantity;
+    order.symbol_id = symbol_id;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.time_in_force = TimeInForce::GTC;
+    order.owner_id = 0;
+    return order;
 }
 
-bool Order::is_sell() const {
-    return side == "SELL";
+Order Order::market_order(uint64_t id, int quantity, Side side, uint16_t symbol_id) {
+    Order order = limit_order(id, 0, quantity, side, symbol_id);
+    order.type = OrderType::MARKET;
+    return order;
 }
 
-bool Order::is_limit() const {
-    return type == "LIMIT";
-}
-
-bool Order::is_market() const {
-    return type == "MARKET";
-}
-
-std::string Order::to_string() const {
+std::string Order::to_string(double tick_size) const {
     std::stringstream ss;
     ss << "Order[ID=" << order_id 
-       << ", " << side << " " << type;
+       << ", " << side_to_string(side) << " " << order_type_to_string(type);
     
     if (is_limit()) {
-        ss << " " << quantity << "@" << price;
+        ss << " " << quantity << "@" << ticks_to_price(price, tick_size);
     } else {
         ss << " " << quantity << "@MARKET";
     }
+    if (time_in_force != TimeInForce::GTC) {
+        ss << " " << time_in_force_to_string(time_in_force);
+    }
     
     ss << ", TS=" << timestamp << "]";
     return ss.str();
 }
 
 bool Order::operator<(const Order& other) const {
-    // First compare by timestamp for time priority
-    return timestamp < other.timestamp;
+    // Timestamps can collide at clock resolution or when a flow file reuses
+    // them, so the id breaks the tie and the order is total
+    if (timestamp != other.timestamp) {
+        return timestamp < other.timestamp;
+    }
+    return order_id < other.order_id;
 }
 
 bool Order::operator==(const Order& other) const {
@@ -79,3 +106,26 @@ uint64_t Order::get_current_timestamp() {
     auto duration = now.time_since_epoch();
     return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
 }
+
+const char* side_to_string(Side side) {
+    return side == Side::BUY ? "BUY" : "SELL";
+}
+
+const char* order_type_to_string(OrderType type) {
+    return type == OrderType::LIMIT ? "LIMIT" : "MARKET";
+}
+
+const char* time_in_force_to_string(TimeInForce time_in_force) {
+    switch (time_in_force) {
+        case TimeInForce::IOC: return "IOC";
+        case TimeInForce::FOK: return "FOK";
+        default: return "GTC";
+    }
+}
+
+TimeInForce time_in_force_from_string(const std::string& text) {
+    if (text == "GTC") return TimeInForce::GTC;
+    if (text == "IOC") return TimeInForce::IOC;
+    if (text == "FOK") return TimeInForce::FOK;
+    throw std::invalid_argument("Time in force must be 'GTC', 'IOC' or 'FOK'");
+}
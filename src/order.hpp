@@ -1,19 +1,46 @@
 #pragma once
 
+#include "price.hpp"
 #include <string>
 #include <chrono>
+#include <cstdint>
+#include <type_traits>
 
+enum class Side : uint8_t {
+    BUY,
+    SELL
+};
+
+enum class OrderType : uint8_t {
+    LIMIT,
+    MARKET
+};
+
+// How long an order may stay working. IOC fills what it can and drops the
+// rest; FOK fills completely on arrival or not at all.
+enum class TimeInForce : uint8_t {
+    GTC,
+    IOC,
+    FOK
+};
+
+// Compact, trivially copyable order record. Strings only appear at the text
+// boundary (validating constructor, string factories and to_string).
 class Order {
 public:
     uint64_t order_id;
-    double price;
+    uint64_t timestamp;    // arrival time in ns; book priority is FIFO order within a level
+    Price price;           // limit price in ticks, 0 for market orders
     int quantity;
-    std::string side;      // "BUY" or "SELL"
-    std::string type;      // "LIMIT" or "MARKET"
-    uint64_t timestamp;
+    uint16_t symbol_id;    // instrument, 0 in single-book setups
+    Side side;
+    OrderType type;
+    TimeInForce time_in_force;
+    uint16_t owner_id;     // account or session that entered the order, 0 when unknown
     
-    // Constructor
-    Order(uint64_t id, double p, int qty, const std::string& s, const std::string& t);
+    // Validating constructor from text fields ("BUY"/"SELL", "LIMIT"/"MARKET")
+    Order(uint64_t id, double p, int qty, const std::string& s, const std::string& t,
+          double tick_size = DEFAULT_TICK_SIZE);
     
     // Default constructor
     Order() = default;
@@ -23,22 +50,41 @@ public:
     Order& operator=(const Order& other) = default;
     
     // Factory methods
-    static Order create_limit_order(uint64_t id, double price, int quantity, const std::string& side);
+    static Order create_limit_order(uint64_t id, double price, int quantity, const std::string& side,
+                                    double tick_size = DEFAULT_TICK_SIZE);
     static Order create_market_order(uint64_t id, int quantity, const std::string& side);
     
+    // Unvalidated factories for callers that already hold ticks and enums
+    static Order limit_order(uint64_t id, Price price, int quantity, Side side, uint16_t symbol_id = 0);
+    static Order market_order(uint64_t id, int quantity, Side side, uint16_t symbol_id = 0);
+    
     // Utility methods
-    bool is_buy() const;
-    bool is_sell() const;
-    bool is_limit() const;
-    bool is_market() const;
+    bool is_buy() const { return side == Side::BUY; }
+    bool is_sell() const { return side == Side::SELL; }
+    bool is_limit() const { return type == OrderType::LIMIT; }
+    bool is_market() const { return type == OrderType::MARKET; }
+    bool is_fill_or_kill() const { return time_in_force == TimeInForce::FOK; }
+    
+    // Market orders never rest, whatever their time in force
+    bool may_rest() const { return is_limit() && time_in_force == TimeInForce::GTC; }
     
     // String representation
-    std::string to_string() const;
+    std::string to_string(double tick_size = DEFAULT_TICK_SIZE) const;
     
-    // Comparison operators for sorting
+    // Comparison operators for sorting; earlier timestamp first, then lower order_id
     bool operator<(const Order& other) const;
     bool operator==(const Order& other) const;
     
-private:
+    // Steady-clock nanoseconds, the clock behind `timestamp`
     static uint64_t get_current_timestamp();
 };
+
+static_assert(std::is_trivially_copyable<Order>::value, "Order must stay trivially copyable");
+static_assert(sizeof(Order) <= 32, "Order must fit in 32 bytes");
+
+const char* side_to_string(Side side);
+const char* order_type_to_string(OrderType type);
+const char* time_in_force_to_string(TimeInForce time_in_force);
+
+// "GTC", "IOC" or "FOK"; throws std::invalid_argument otherwise
+TimeInForce time_in_force_from_string(const std::string& text);
@@ -3,128 +3,163 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <limits>
 
-void OrderBook::add_order(const Order& order) {
+OrderBook::OrderBook(double tick_size, size_t initial_levels, size_t order_capacity)
+    : tick(tick_size), initial_levels(std::max<size_t>(initial_levels, 1)),
+      order_pool(order_capacity), order_locations(order_capacity) {
+}
+
+OrderBook::~OrderBook() {
+    order_locations.for_each([this](uint64_t, OrderNode* node) { order_pool.destroy(node); });
+}
+
+bool OrderBook::add_order(const Order& order) {
     if (!order.is_limit()) {
         LOG_ERROR("Cannot add market order to order book directly");
-        return;
+        return false;
     }
     
-    double price = order.price;
+    if (order_locations.contains(order.order_id)) {
+        LOG_ERROR("Duplicate order id {}", order.order_id);
+        return false;
+    }
     
-    if (order.is_buy()) {
-        buy_orders[price].push_back(order);
-        order_locations[order.order_id] = {price, true};
-        LOG_DEBUG("Added buy order " + order.to_string() + " to price level " + std::to_string(price));
-    } else {
-        sell_orders[price].push_back(order);
-        order_locations[order.order_id] = {price, false};
-        LOG_DEBUG("Added sell order " + order.to_string() + " to price level " + std::to_string(price));
+    bool is_buy = order.is_buy();
+    Price price = order.price;
+    PriceLadder& side = ladder(is_buy);
+    
+    Level* level = level_for(side, price);
+    if (!level) {
+        LOG_ERROR("Price {} is outside the price ladder range", to_price(price));
+        return false;
     }
+    
+    OrderNode* node = order_pool.create(OrderNode{order});
+    
+    bool was_empty = level->empty();
+    link_order(*level, node);
+    side.order_count++;
+    side.total_quantity += order.quantity;
+    if (was_empty) {
+        on_level_filled(side, static_cast<int>(price - side.base_price), is_buy);
+    }
+    order_locations.insert(order.order_id, node);
+    publish_level(is_buy, price, *level);
+    
+    LOG_DEBUG("Added {} order {} qty {} to price level {}",
+              is_buy ? "buy" : "sell", order.order_id, order.quantity, to_price(price));
+    return true;
 }
 
 bool OrderBook::cancel_order(uint64_t order_id) {
-    auto it = order_locations.find(order_id);
-    if (it == order_locations.end()) {
-        LOG_DEBUG("Order " + std::to_string(order_id) + " not found for cancellation");
+    OrderNode* node = order_locations.erase(order_id);
+    if (!node) {
+        LOG_DEBUG("Order {} not found for cancellation", order_id);
         return false;
     }
     
-    double price = it->second.first;
-    bool is_buy = it->second.second;
-    
-    remove_order_from_level(order_id, price, is_buy);
-    order_locations.erase(it);
-    clean_empty_levels();
+    remove_order(node);
     
-    LOG_INFO("Cancelled order " + std::to_string(order_id));
+    LOG_INFO("Cancelled order {}", order_id);
     return true;
 }
 
-bool OrderBook::modify_order(uint64_t order_id, int new_quantity) {
-    auto it = order_locations.find(order_id);
-    if (it == order_locations.end()) {
-        LOG_DEBUG("Order " + std::to_string(order_id) + " not found for modification");
+bool OrderBook::reduce_order(uint64_t order_id, int new_quantity) {
+    OrderNode* node = order_locations.find(order_id);
+    if (!node) {
+        LOG_DEBUG("Order {} not found for modification", order_id);
         return false;
     }
     
-    if (new_quantity <= 0) {
-        LOG_ERROR("Invalid quantity for modification: " + std::to_string(new_quantity));
+    int old_quantity = node->order.quantity;
+    if (new_quantity <= 0 || new_quantity > old_quantity) {
+        LOG_ERROR("Invalid quantity reduction for order {}: {} to {}", order_id, old_quantity, new_quantity);
         return false;
     }
     
-    double price = it->second.first;
-    bool is_buy = it->second.second;
-    
-    // Find and modify the order
-    auto& orders = is_buy ? buy_orders[price] : sell_orders[price];
+    // The node stays where it is in the queue; only the totals move
+    PriceLadder& side = ladder(node->order.is_buy());
+    Level& level = level_of(side, node);
+    level.total_quantity -= old_quantity - new_quantity;
+    side.total_quantity -= old_quantity - new_quantity;
+    node->order.quantity = new_quantity;
+    publish_level(node->order.is_buy(), node->order.price, level);
+    LOG_INFO("Reduced order {} quantity from {} to {}", order_id, old_quantity, new_quantity);
+    return true;
+}
+
+size_t OrderBook::mass_cancel(const MassCancel& filter) {
+    constexpr Price lowest = std::numeric_limits<Price>::min();
+    constexpr Price highest = std::numeric_limits<Price>::max();
+    bool is_buy = filter.side == Side::BUY;
+    size_t cancelled = 0;
     
-    for (auto& order : orders) {
-        if (order.order_id == order_id) {
-            int old_quantity = order.quantity;
-            order.quantity = new_quantity;
-            LOG_INFO("Modified order " + std::to_string(order_id) + 
-                    " quantity from " + std::to_string(old_quantity) + 
-                    " to " + std::to_string(new_quantity));
-            return true;
-        }
+    switch (filter.scope) {
+        case MassCancelScope::ALL:
+            // Nothing survives, so the levels are reset without visiting their
+            // orders and the index and node pool are wiped in one sweep each
+            cancelled = release_levels(true, lowest, highest, true) + release_levels(false, lowest, highest, true);
+            order_locations.clear();
+            order_pool.release_all();
+            break;
+        case MassCancelScope::SIDE:
+            cancelled = release_levels(is_buy, lowest, highest, false);
+            break;
+        case MassCancelScope::PRICE_RANGE:
+            cancelled = release_levels(is_buy, filter.low, filter.high, false);
+            break;
+        case MassCancelScope::OWNER:
+            // Only the populated levels, best first; removals only empty the
+            // level being walked, so the ones ahead are still counted correctly
+            for (bool buy_side : {true, false}) {
+                PriceLadder& side = ladder(buy_side);
+                int step = buy_side ? -1 : 1;
+                size_t remaining = side.level_count;
+                for (int i = side.best; remaining > 0; i += step) {
+                    Level& level = side.levels[i];
+                    if (level.empty()) continue;
+                    remaining--;
+                    for (OrderNode* node = level.head; node;) {
+                        OrderNode* next = node->next;
+                        if (node->order.owner_id == filter.owner_id) {
+                            order_locations.erase(node->order.order_id);
+                            remove_order(node);
+                            cancelled++;
+                        }
+                        node = next;
+                    }
+                }
+            }
+            break;
     }
     
-    return false;
+    LOG_INFO("Mass cancel removed {} orders", cancelled);
+    return cancelled;
 }
 
 TopOfBook OrderBook::get_top_of_book() const {
     TopOfBook tob;
     
-    if (!buy_orders.empty()) {
-        auto best_buy_it = buy_orders.begin();
-        tob.best_bid = best_buy_it->first;
-        tob.bid_quantity = calculate_level_quantity(best_buy_it->second);
+    if (buy_orders.best >= 0) {
+        tob.best_bid = to_price(buy_orders.base_price + buy_orders.best);
+        tob.bid_quantity = buy_orders.levels[buy_orders.best].total_quantity;
     }
     
-    if (!sell_orders.empty()) {
-        auto best_sell_it = sell_orders.begin();
-        tob.best_ask = best_sell_it->first;
-        tob.ask_quantity = calculate_level_quantity(best_sell_it->second);
+    if (sell_orders.best >= 0) {
+        tob.best_ask = to_price(sell_orders.base_price + sell_orders.best);
+        tob.ask_quantity = sell_orders.levels[sell_orders.best].total_quantity;
     }
     
     return tob;
 }
 
 std::vector<PriceLevel> OrderBook::get_bid_levels(int depth) const {
-    std::vector<PriceLevel> levels;
-    
-    int count = 0;
-    for (const auto& [price, orders] : buy_orders) {
-        if (count >= depth || orders.empty()) break;
-        
-        levels.push_back({
-            price,
-            calculate_level_quantity(orders),
-            static_cast<int>(orders.size())
-        });
-        count++;
-    }
-    
-    return levels;
+    return collect_levels(true, depth);
 }
 
 std::vector<PriceLevel> OrderBook::get_ask_levels(int depth) const {
-    std::vector<PriceLevel> levels;
-    
-    int count = 0;
-    for (const auto& [price, orders] : sell_orders) {
-        if (count >= depth || orders.empty()) break;
-        
-        levels.push_back({
-            price,
-            calculate_level_quantity(orders),
-            static_cast<int>(orders.size())
-        });
-        count++;
-    }
-    
-    return levels;
+    return collect_levels(false, depth);
 }
 
 void OrderBook::print_book(int depth) const {
@@ -136,9 +171,9 @@ void OrderBook::print_book(int depth) const {
     std::reverse(ask_levels.begin(), ask_levels.end());
     
     for (const auto& level : ask_levels) {
-        std::cout << std::setw(12) << "" 
-                  << std::setw(8) << level.total_quantity 
-                  << " @ " << std::setw(8) << level.price 
+        std::cout << std::setw(12) << ""
+                  << std::setw(8) << level.total_quantity
+                  << " @ " << std::setw(8) << level.price
                   << " SELL (" << level.order_count << " orders)" << std::endl;
     }
     
@@ -147,70 +182,287 @@ void OrderBook::print_book(int depth) const {
     // Print bid levels (buys)
     auto bid_levels = get_bid_levels(depth);
     for (const auto& level : bid_levels) {
-        std::cout << "BUY (" << level.order_count << " orders) " 
-                  << std::setw(8) << level.price 
+        std::cout << "BUY (" << level.order_count << " orders) "
+                  << std::setw(8) << level.price
                   << " @ " << std::setw(8) << level.total_quantity << std::endl;
     }
     
     TopOfBook tob = get_top_of_book();
     if (tob.best_bid && tob.best_ask) {
         double spread = *tob.best_ask - *tob.best_bid;
-        std::cout << "\nSpread: " << spread << " (" 
-                  << std::setprecision(4) << (spread / *tob.best_bid * 100) 
+        std::cout << "\nSpread: " << spread << " ("
+                  << std::setprecision(4) << (spread / *tob.best_bid * 100)
                   << "%)" << std::endl;
     }
     std::cout << "==================\n" << std::endl;
 }
 
-size_t OrderBook::total_orders() const {
-    size_t count = 0;
-    for (const auto& [price, orders] : buy_orders) {
-        count += orders.size();
+bool OrderBook::has_orders(bool buy_side) const {
+    return ladder(buy_side).best >= 0;
+}
+
+Price OrderBook::best_price(bool buy_side) const {
+    const PriceLadder& side = ladder(buy_side);
+    return side.base_price + side.best;
+}
+
+Order& OrderBook::front_order(bool buy_side) {
+    PriceLadder& side = ladder(buy_side);
+    return side.levels[side.best].head->order;
+}
+
+void OrderBook::consume_front(bool buy_side, int quantity) {
+    PriceLadder& side = ladder(buy_side);
+    Level& level = side.levels[side.best];
+    OrderNode* node = level.head;
+    
+    node->order.quantity -= quantity;
+    level.total_quantity -= quantity;
+    side.total_quantity -= quantity;
+    if (node->order.quantity > 0) {
+        publish_level(buy_side, node->order.price, level);
+        return;
+    }
+    
+    LOG_DEBUG("Removing fully filled passive order {}", node->order.order_id);
+    order_locations.erase(node->order.order_id);
+    remove_order(node);
+}
+
+int64_t OrderBook::available_quantity(bool buy_side, Price limit_price, int64_t target) const {
+    const PriceLadder& side = ladder(buy_side);
+    if (side.total_quantity < target) {
+        return side.total_quantity;     // short even if every level were eligible
     }
-    for (const auto& [price, orders] : sell_orders) {
-        count += orders.size();
+    
+    int step = buy_side ? -1 : 1;
+    int64_t available = 0;
+    size_t found = 0;
+    for (int i = side.best; found < side.level_count && available < target; i += step) {
+        const Level& level = side.levels[i];
+        if (level.empty()) continue;
+        
+        Price price = side.base_price + i;
+        if (buy_side ? price < limit_price : price > limit_price) {
+            break;
+        }
+        available += level.total_quantity;
+        found++;
     }
-    return count;
+    return available;
+}
+
+size_t OrderBook::total_orders() const {
+    return buy_orders.order_count + sell_orders.order_count;
+}
+
+int64_t OrderBook::total_quantity() const {
+    return buy_orders.total_quantity + sell_orders.total_quantity;
 }
 
 bool OrderBook::empty() const {
-    return buy_orders.empty() && sell_orders.empty();
+    return buy_orders.best < 0 && sell_orders.best < 0;
+}
+
+BookMemoryStats OrderBook::memory_stats() const {
+    return {
+        order_pool.capacity(),
+        order_pool.in_use(),
+        order_pool.high_water_mark(),
+        buy_orders.levels.size() + sell_orders.levels.size(),
+        level_high_water_mark,
+        order_locations.capacity(),
+        order_locations.memory_bytes()
+    };
 }
 
-void OrderBook::remove_order_from_level(uint64_t order_id, double price, bool is_buy) {
-    auto& orders = is_buy ? buy_orders[price] : sell_orders[price];
+bool OrderBook::fits_ladder(const PriceLadder& side, Price price) {
+    if (side.levels.empty()) {
+        return price >= 0;
+    }
+    int64_t end_price = static_cast<int64_t>(side.base_price) + static_cast<int64_t>(side.levels.size());
+    int64_t low = std::min<int64_t>(price, side.base_price);
+    int64_t high = std::max<int64_t>(static_cast<int64_t>(price) + 1, end_price);
+    return static_cast<uint64_t>(high - low) <= MAX_LADDER_LEVELS;
+}
+
+OrderBook::Level* OrderBook::level_for(PriceLadder& side, Price price) {
+    if (side.levels.empty()) {
+        side.base_price = std::max<Price>(0, price - static_cast<Price>(initial_levels / 2));
+        side.levels.resize(initial_levels);
+    }
     
-    orders.erase(
-        std::remove_if(orders.begin(), orders.end(),
-            [order_id](const Order& order) { return order.order_id == order_id; }),
-        orders.end()
-    );
+    int64_t end_price = static_cast<int64_t>(side.base_price) + static_cast<int64_t>(side.levels.size());
+    if (price >= side.base_price && price < end_price) {
+        return &side.levels[price - side.base_price];
+    }
+    
+    // Grow geometrically towards the new price so repeated extensions stay amortised
+    if (!fits_ladder(side, price)) {
+        return nullptr;
+    }
+    int64_t low = std::min<int64_t>(price, side.base_price);
+    int64_t high = std::max<int64_t>(static_cast<int64_t>(price) + 1, end_price);
+    size_t span = std::max(static_cast<size_t>(high - low), side.levels.size() * 2);
+    span = std::min(span, MAX_LADDER_LEVELS);
+    
+    Price new_base = side.base_price;
+    if (price < side.base_price) {
+        new_base = static_cast<Price>(std::max<int64_t>(0, high - static_cast<int64_t>(span)));
+    }
+    
+    std::vector<Level> grown(span);
+    size_t offset = static_cast<size_t>(side.base_price - new_base);
+    std::move(side.levels.begin(), side.levels.end(), grown.begin() + offset);
+    side.levels = std::move(grown);
+    if (side.best >= 0) {
+        side.best += static_cast<int>(offset);
+    }
+    side.base_price = new_base;
+    
+    return &side.levels[price - side.base_price];
 }
 
-void OrderBook::clean_empty_levels() {
-    // Clean empty buy levels
-    for (auto it = buy_orders.begin(); it != buy_orders.end();) {
-        if (it->second.empty()) {
-            it = buy_orders.erase(it);
-        } else {
-            ++it;
-        }
+void OrderBook::on_level_filled(PriceLadder& side, int index, bool is_buy) {
+    side.level_count++;
+    level_high_water_mark = std::max(level_high_water_mark,
+                                     buy_orders.level_count + sell_orders.level_count);
+    if (side.best < 0 || (is_buy ? index > side.best : index < side.best)) {
+        side.best = index;
+    }
+}
+
+void OrderBook::on_level_emptied(PriceLadder& side, int index, bool is_buy) {
+    side.level_count--;
+    if (index != side.best) {
+        return;
+    }
+    
+    if (side.level_count == 0) {
+        side.best = -1;
+        return;
     }
     
-    // Clean empty sell levels
-    for (auto it = sell_orders.begin(); it != sell_orders.end();) {
-        if (it->second.empty()) {
-            it = sell_orders.erase(it);
-        } else {
-            ++it;
+    // Walk away from the touch until the next populated level
+    int step = is_buy ? -1 : 1;
+    int next = index + step;
+    while (side.levels[next].empty()) {
+        next += step;
+    }
+    side.best = next;
+}
+
+std::vector<PriceLevel> OrderBook::collect_levels(bool is_buy, int depth) const {
+    std::vector<PriceLevel> levels;
+    const PriceLadder& side = ladder(is_buy);
+    if (side.best < 0) {
+        return levels;
+    }
+    
+    int step = is_buy ? -1 : 1;
+    size_t found = 0;
+    for (int i = side.best; found < side.level_count && static_cast<int>(levels.size()) < depth; i += step) {
+        const Level& level = side.levels[i];
+        if (level.empty()) continue;
+        
+        levels.push_back({
+            to_price(side.base_price + i),
+            level.total_quantity,
+            level.order_count
+        });
+        found++;
+    }
+    
+    return levels;
+}
+
+void OrderBook::link_order(Level& level, OrderNode* node) {
+    node->prev = level.tail;
+    node->next = nullptr;
+    if (level.tail) {
+        level.tail->next = node;
+    } else {
+        level.head = node;
+    }
+    level.tail = node;
+    level.order_count++;
+    level.total_quantity += node->order.quantity;
+}
+
+void OrderBook::unlink_order(Level& level, OrderNode* node) {
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        level.head = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        level.tail = node->prev;
+    }
+    level.order_count--;
+    level.total_quantity -= node->order.quantity;
+}
+
+size_t OrderBook::release_levels(bool is_buy, Price low, Price high, bool whole_book) {
+    PriceLadder& side = ladder(is_buy);
+    if (side.best < 0 || low > high) {
+        return 0;
+    }
+    
+    // Populated levels lie on the far side of the touch, so the scan starts at
+    // whichever comes first of the touch and the range edge
+    int64_t first = std::max<int64_t>(int64_t(low) - side.base_price, 0);
+    int64_t last = std::min<int64_t>(int64_t(high) - side.base_price, int64_t(side.levels.size()) - 1);
+    if (is_buy) {
+        last = std::min<int64_t>(last, side.best);
+    } else {
+        first = std::max<int64_t>(first, side.best);
+    }
+    if (first > last) {
+        return 0;
+    }
+    
+    // Clear from the touch outwards, so a best-level refresh never walks
+    // further than the next level this loop visits anyway
+    int step = is_buy ? -1 : 1;
+    int begin = static_cast<int>(is_buy ? last : first);
+    int end = static_cast<int>(is_buy ? first : last) + step;
+    size_t released = 0;
+    for (int i = begin; i != end && side.level_count > 0; i += step) {
+        Level& level = side.levels[i];
+        if (level.empty()) continue;
+        
+        for (OrderNode* node = whole_book ? nullptr : level.head; node;) {
+            OrderNode* next = node->next;
+            order_locations.erase(node->order.order_id);
+            order_pool.destroy(node);
+            node = next;
         }
+        released += level.order_count;
+        side.order_count -= level.order_count;
+        side.total_quantity -= level.total_quantity;
+        level = Level();
+        publish_level(is_buy, side.base_price + i, level);
+        on_level_emptied(side, i, is_buy);
     }
+    return released;
 }
 
-int OrderBook::calculate_level_quantity(const std::deque<Order>& orders) const {
-    int total = 0;
-    for (const auto& order : orders) {
-        total += order.quantity;
+void OrderBook::remove_order(OrderNode* node) {
+    bool is_buy = node->order.is_buy();
+    PriceLadder& side = ladder(is_buy);
+    int index = static_cast<int>(node->order.price - side.base_price);
+    Level& level = side.levels[index];
+    
+    unlink_order(level, node);
+    side.order_count--;
+    side.total_quantity -= node->order.quantity;
+    publish_level(is_buy, node->order.price, level);
+    order_pool.destroy(node);
+    
+    // Only the affected level is retired when it runs out of orders
+    if (level.empty()) {
+        on_level_emptied(side, index, is_buy);
     }
-    return total;
 }
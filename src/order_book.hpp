@@ -1,11 +1,13 @@
 #pragma once
 
+#include "market_data.hpp"
+#include "mass_cancel.hpp"
 #include "order.hpp"
-#include <map>
-#include <deque>
+#include "price.hpp"
+#include "utils/object_pool.hpp"
+#include "utils/order_index.hpp"
 #include <vector>
 #include <optional>
-#include <unordered_map>
 
 struct TopOfBook {
     std::optional<double> best_bid;
@@ -20,46 +22,210 @@ struct PriceLevel {
     int order_count;
 };
 
+struct BookMemoryStats {
+    size_t order_capacity;          // order node slots currently reserved
+    size_t orders_in_use;
+    size_t order_high_water_mark;   // most order nodes ever live at once
+    size_t level_capacity;          // ladder slots across both sides
+    size_t level_high_water_mark;   // most populated levels ever live at once
+    size_t index_capacity;          // orders the ID index holds before it grows
+    size_t index_bytes;
+};
+
 class OrderBook {
 public:
-    OrderBook() = default;
+    static constexpr size_t DEFAULT_ORDER_CAPACITY = 4096;
+    
+    explicit OrderBook(double tick_size = DEFAULT_TICK_SIZE, size_t initial_levels = 1024,
+                       size_t order_capacity = DEFAULT_ORDER_CAPACITY);
+    ~OrderBook();
+    
+    // Levels hold raw pointers to their orders, so books are not copyable
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
     
     // Core order management
-    void add_order(const Order& order);
+    bool add_order(const Order& order);
     bool cancel_order(uint64_t order_id);
-    bool modify_order(uint64_t order_id, int new_quantity);
+    
+    // Shrinks a resting order in place, keeping its queue position. Fails for
+    // increases, which must go through MatchingEngine::modify_order instead.
+    bool reduce_order(uint64_t order_id, int new_quantity);
+    
+    // Withdraws every resting order `filter` selects and returns how many. All,
+    // side and price range release whole levels at once and only visit the
+    // levels in range; owner walks the populated levels and every order on them.
+    size_t mass_cancel(const MassCancel& filter);
     
     // Book information
+    bool has_order(uint64_t order_id) const { return order_locations.contains(order_id); }
+    const Order* find_order(uint64_t order_id) const {
+        const OrderNode* node = order_locations.find(order_id);
+        return node ? &node->order : nullptr;
+    }
     TopOfBook get_top_of_book() const;
     std::vector<PriceLevel> get_bid_levels(int depth = 5) const;
     std::vector<PriceLevel> get_ask_levels(int depth = 5) const;
     
+    // Resting orders on one side from the best level outwards, FIFO within each level
+    template <typename Visitor>
+    void for_each_order(bool buy_side, Visitor&& visit) const;
+    
+    // Populated levels on one side from the best outwards as visit(price, quantity);
+    // the walk stops early once visit returns false
+    template <typename Visitor>
+    void for_each_level(bool buy_side, Visitor&& visit) const;
+    
     // Display
     void print_book(int depth = 5) const;
     
-    // Internal access for matching engine
-    std::map<double, std::deque<Order>, std::greater<double>>& get_buy_orders() { return buy_orders; }
-    std::map<double, std::deque<Order>>& get_sell_orders() { return sell_orders; }
+    // Level 2 delta feed: `listener` sees every level change as it happens
+    void set_level_listener(LevelUpdateCallback listener) { level_listener = std::move(listener); }
+    uint64_t update_sequence() const { return level_sequence; }
+    
+    // Matching access: resting liquidity on one side of the book
+    bool has_orders(bool buy_side) const;
+    Price best_price(bool buy_side) const;
+    Order& front_order(bool buy_side);
+    void consume_front(bool buy_side, int quantity);
+    
+    // Resting quantity at one price, 0 when the level is empty or off the ladder
+    int level_quantity(bool buy_side, Price price) const {
+        const PriceLadder& side = ladder(buy_side);
+        Price index = price - side.base_price;
+        if (index < 0 || static_cast<size_t>(index) >= side.levels.size()) {
+            return 0;
+        }
+        return side.levels[index].total_quantity;
+    }
+    
+    // Whether an order at `price` could rest on that side without the ladder
+    // spanning more than MAX_LADDER_LEVELS ticks
+    bool fits_ladder(bool buy_side, Price price) const { return fits_ladder(ladder(buy_side), price); }
     
-    const std::map<double, std::deque<Order>, std::greater<double>>& get_buy_orders() const { return buy_orders; }
-    const std::map<double, std::deque<Order>>& get_sell_orders() const { return sell_orders; }
+    // Resting quantity on one side at prices no worse than `limit_price`, summed
+    // from the level totals best level first; stops early once `target` is reached
+    int64_t available_quantity(bool buy_side, Price limit_price, int64_t target) const;
+    
+    // Price conversion
+    double tick_size() const { return tick; }
+    Price to_ticks(double price) const { return price_to_ticks(price, tick); }
+    double to_price(Price ticks) const { return ticks_to_price(ticks, tick); }
     
     // Statistics
     size_t total_orders() const;
+    int64_t total_quantity() const;
+    size_t side_orders(bool buy_side) const { return ladder(buy_side).order_count; }
+    int64_t side_quantity(bool buy_side) const { return ladder(buy_side).total_quantity; }
     bool empty() const;
+    BookMemoryStats memory_stats() const;
+    OrderIndexStats index_stats() const { return order_locations.stats(); }
     
+    // Upper bound on the number of ticks a single side may span
+    static constexpr size_t MAX_LADDER_LEVELS = 1 << 20;
+
 private:
-    // Buy orders: price -> queue of orders (sorted descending by price)
-    std::map<double, std::deque<Order>, std::greater<double>> buy_orders;
+    // Resting order linked into its level's FIFO queue
+    struct OrderNode {
+        Order order;
+        OrderNode* prev = nullptr;
+        OrderNode* next = nullptr;
+    };
+    
+    // Intrusive doubly-linked FIFO of the orders at one price, with running totals
+    struct Level {
+        OrderNode* head = nullptr;
+        OrderNode* tail = nullptr;
+        int total_quantity = 0;
+        int order_count = 0;
+        
+        bool empty() const { return head == nullptr; }
+    };
+    
+    // Contiguous levels indexed by (price - base_price), one ladder per side
+    struct PriceLadder {
+        std::vector<Level> levels;
+        Price base_price = 0;
+        int best = -1;              // index of best non-empty level, -1 when empty
+        size_t level_count = 0;     // number of non-empty levels
+        size_t order_count = 0;
+        int64_t total_quantity = 0;
+    };
+    
+    double tick;
+    size_t initial_levels;
+    PriceLadder buy_orders;
+    PriceLadder sell_orders;
+    size_t level_high_water_mark = 0;
+    
+    LevelUpdateCallback level_listener;
+    uint64_t level_sequence = 0;
     
-    // Sell orders: price -> queue of orders (sorted ascending by price)
-    std::map<double, std::deque<Order>> sell_orders;
+    // Slab for resting orders, recycled on removal
+    ObjectPool<OrderNode> order_pool;
     
-    // Order ID to location mapping for fast cancellation
-    std::unordered_map<uint64_t, std::pair<double, bool>> order_locations; // price, is_buy
+    // Order ID to resting node for constant-time cancellation; holds exactly
+    // the resting orders, fills and cancels remove their entries
+    OrderIndex<OrderNode> order_locations;
     
     // Helper methods
-    void remove_order_from_level(uint64_t order_id, double price, bool is_buy);
-    void clean_empty_levels();
-    int calculate_level_quantity(const std::deque<Order>& orders) const;
+    PriceLadder& ladder(bool is_buy) { return is_buy ? buy_orders : sell_orders; }
+    const PriceLadder& ladder(bool is_buy) const { return is_buy ? buy_orders : sell_orders; }
+    Level* level_for(PriceLadder& side, Price price);
+    static bool fits_ladder(const PriceLadder& side, Price price);
+    Level& level_of(PriceLadder& side, const OrderNode* node) { return side.levels[node->order.price - side.base_price]; }
+    void on_level_filled(PriceLadder& side, int index, bool is_buy);
+    void on_level_emptied(PriceLadder& side, int index, bool is_buy);
+    std::vector<PriceLevel> collect_levels(bool is_buy, int depth) const;
+    void link_order(Level& level, OrderNode* node);
+    void unlink_order(Level& level, OrderNode* node);
+    void remove_order(OrderNode* node);
+    size_t release_levels(bool is_buy, Price low, Price high, bool whole_book);
+    
+    void publish_level(bool is_buy, Price price, const Level& level) {
+        if (level_listener) {
+            level_listener({++level_sequence, price, level.total_quantity, level.order_count,
+                            is_buy ? Side::BUY : Side::SELL});
+        }
+    }
 };
+
+template <typename Visitor>
+void OrderBook::for_each_order(bool buy_side, Visitor&& visit) const {
+    const PriceLadder& side = ladder(buy_side);
+    if (side.best < 0) {
+        return;
+    }
+    
+    int step = buy_side ? -1 : 1;
+    size_t found = 0;
+    for (int i = side.best; found < side.level_count; i += step) {
+        const Level& level = side.levels[i];
+        if (level.empty()) continue;
+        
+        for (const OrderNode* node = level.head; node; node = node->next) {
+            visit(node->order);
+        }
+        found++;
+    }
+}
+
+template <typename Visitor>
+void OrderBook::for_each_level(bool buy_side, Visitor&& visit) const {
+    const PriceLadder& side = ladder(buy_side);
+    if (side.best < 0) {
+        return;
+    }
+    
+    int step = buy_side ? -1 : 1;
+    size_t found = 0;
+    for (int i = side.best; found < side.level_count; i += step) {
+        const Level& level = side.levels[i];
+        if (level.empty()) continue;
+        
+        if (!visit(side.base_price + i, level.total_quantity)) {
+            return;
+        }
+        found++;
+    }
+}
@@ -0,0 +1,144 @@
+#include "order_flow.hpp"
+#include "utils/logger.hpp"
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FlowRecorder::~FlowRecorder() {
+    close();
+}
+
+bool FlowRecorder::open(const std::string& path, double tick_size) {
+    close();
+    
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Cannot open flow file {} for writing", path);
+        return false;
+    }
+    
+    FlowFileHeader header{};
+    std::memcpy(header.magic, FLOW_FILE_MAGIC, sizeof(header.magic));
+    header.version = FLOW_FILE_VERSION;
+    header.record_size = sizeof(Command);
+    header.tick_size = tick_size;
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        LOG_ERROR("Cannot write flow file header to {}", path);
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    
+    buffer.clear();
+    buffer.reserve(BUFFER_RECORDS);
+    count = 0;
+    failed = false;
+    return true;
+}
+
+void FlowRecorder::record(const Command& command) {
+    if (!file) {
+        return;
+    }
+    buffer.push_back(command);
+    count++;
+    if (buffer.size() == BUFFER_RECORDS) {
+        flush_buffer();
+    }
+}
+
+bool FlowRecorder::flush_buffer() {
+    if (!buffer.empty() && std::fwrite(buffer.data(), sizeof(Command), buffer.size(), file) != buffer.size()) {
+        LOG_ERROR("Short write to flow file after {} records", count);
+        failed = true;
+    }
+    buffer.clear();
+    return !failed;
+}
+
+bool FlowRecorder::close() {
+    if (!file) {
+        return true;
+    }
+    
+    flush_buffer();
+    
+    // Patch the final record count into the header
+    if (std::fseek(file, offsetof(FlowFileHeader, record_count), SEEK_SET) != 0 ||
+        std::fwrite(&count, sizeof(count), 1, file) != 1) {
+        LOG_ERROR("Cannot update flow file record count");
+        failed = true;
+    }
+    
+    if (std::fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+    return !failed;
+}
+
+FlowReader::~FlowReader() {
+    close();
+}
+
+bool FlowReader::open(const std::string& path) {
+    close();
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open flow file {}", path);
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FlowFileHeader)) {
+        LOG_ERROR("Flow file {} is too short", path);
+        ::close(fd);
+        return false;
+    }
+    
+    mapping_size = static_cast<size_t>(info.st_size);
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Cannot map flow file {}", path);
+        mapping = nullptr;
+        mapping_size = 0;
+        return false;
+    }
+    madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+    
+    const FlowFileHeader* header = static_cast<const FlowFileHeader*>(mapping);
+    if (std::memcmp(header->magic, FLOW_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != FLOW_FILE_VERSION || header->record_size != sizeof(Command)) {
+        LOG_ERROR("{} is not a version {} flow file", path, FLOW_FILE_VERSION);
+        close();
+        return false;
+    }
+    
+    // A recorder that never closed leaves record_count at 0; trust the file size then
+    size_t available = (mapping_size - sizeof(FlowFileHeader)) / sizeof(Command);
+    if (header->record_count > available) {
+        LOG_ERROR("Flow file {} is truncated: {} of {} records", path, available, header->record_count);
+        close();
+        return false;
+    }
+    
+    count = header->record_count ? header->record_count : available;
+    tick = header->tick_size;
+    records = reinterpret_cast<const Command*>(static_cast<const char*>(mapping) + sizeof(FlowFileHeader));
+    return true;
+}
+
+void FlowReader::close() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0;
+    records = nullptr;
+    count = 0;
+}
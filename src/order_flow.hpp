@@ -0,0 +1,74 @@
+#pragma once
+
+#include "command.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Flow file layout: one FlowFileHeader followed by raw Command records in
+// host byte order. record_count is patched in when the recorder closes.
+struct FlowFileHeader {
+    char magic[8];          // "LOBFLOW"
+    uint32_t version;
+    uint32_t record_size;   // sizeof(Command) when written
+    uint64_t record_count;
+    double tick_size;
+};
+
+static_assert(sizeof(FlowFileHeader) == 32, "Flow file header is fixed-width");
+
+constexpr char FLOW_FILE_MAGIC[8] = "LOBFLOW";
+constexpr uint32_t FLOW_FILE_VERSION = 4;     // 2: Order carries a time in force, 3: and an owner, 4: auction commands
+
+// Appends commands to a flow file through a fixed write buffer
+class FlowRecorder {
+public:
+    FlowRecorder() = default;
+    ~FlowRecorder();
+    
+    FlowRecorder(const FlowRecorder&) = delete;
+    FlowRecorder& operator=(const FlowRecorder&) = delete;
+    
+    bool open(const std::string& path, double tick_size);
+    void record(const Command& command);
+    bool close();
+    
+    bool is_open() const { return file != nullptr; }
+    uint64_t recorded() const { return count; }
+
+private:
+    static constexpr size_t BUFFER_RECORDS = 4096;
+    
+    bool flush_buffer();
+    
+    std::FILE* file = nullptr;
+    std::vector<Command> buffer;
+    uint64_t count = 0;
+    bool failed = false;
+};
+
+// Read-only memory mapping of a flow file; commands are used in place
+class FlowReader {
+public:
+    FlowReader() = default;
+    ~FlowReader();
+    
+    FlowReader(const FlowReader&) = delete;
+    FlowReader& operator=(const FlowReader&) = delete;
+    
+    bool open(const std::string& path);
+    void close();
+    
+    const Command* begin() const { return records; }
+    const Command* end() const { return records + count; }
+    size_t size() const { return count; }
+    double tick_size() const { return tick; }
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    const Command* records = nullptr;
+    size_t count = 0;
+    double tick = DEFAULT_TICK_SIZE;
+};
@@ -0,0 +1,329 @@
+#include "pipeline.hpp"
+#include "utils/logger.hpp"
+#include "utils/tsc_clock.hpp"
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+bool parse_command(const char* text, size_t length, double tick_size, Command& command) {
+    char buffer[64];
+    if (length >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    
+    constexpr size_t MAX_TOKENS = 6;
+    char* tokens[MAX_TOKENS];
+    size_t count = 0;
+    char* save = nullptr;
+    for (char* token = strtok_r(buffer, " \t\r\n", &save); token && count < MAX_TOKENS;
+         token = strtok_r(nullptr, " \t\r\n", &save)) {
+        tokens[count++] = token;
+    }
+    if (count == 0) {
+        return false;
+    }
+    
+    char* end = nullptr;
+    command = Command{};
+    
+    if (strcasecmp(tokens[0], "ADD") == 0 && (count == 5 || count == 6)) {
+        Order& order = command.order;
+        if (strcasecmp(tokens[1], "BUY") == 0) {
+            order.side = Side::BUY;
+        } else if (strcasecmp(tokens[1], "SELL") == 0) {
+            order.side = Side::SELL;
+        } else {
+            return false;
+        }
+        
+        if (strcasecmp(tokens[2], "LIMIT") == 0) {
+            order.type = OrderType::LIMIT;
+        } else if (strcasecmp(tokens[2], "MARKET") == 0) {
+            order.type = OrderType::MARKET;
+        } else {
+            return false;
+        }
+        
+        double price = std::strtod(tokens[3], &end);
+        if (*end != '\0') {
+            return false;
+        }
+        long quantity = std::strtol(tokens[4], &end, 10);
+        if (*end != '\0' || quantity <= 0 || quantity > INT_MAX) {
+            return false;
+        }
+        if (order.is_limit() && (price <= 0.0 || !try_price_to_ticks(price, tick_size, order.price) ||
+                                 order.price <= 0)) {
+            return false;
+        }
+        
+        if (count == 6) {
+            if (strcasecmp(tokens[5], "IOC") == 0) {
+                order.time_in_force = TimeInForce::IOC;
+            } else if (strcasecmp(tokens[5], "FOK") == 0) {
+                order.time_in_force = TimeInForce::FOK;
+            } else if (strcasecmp(tokens[5], "GTC") != 0) {
+                return false;
+            }
+        }
+        
+        if (!order.is_limit()) {
+            order.price = 0;
+        }
+        order.quantity = static_cast<int>(quantity);
+        command.type = CommandType::ADD;
+        return true;
+    }
+    
+    if (strcasecmp(tokens[0], "CANCEL") == 0 && count == 2) {
+        command.order.order_id = std::strtoull(tokens[1], &end, 10);
+        command.type = CommandType::CANCEL;
+        return *end == '\0';
+    }
+    
+    if (strcasecmp(tokens[0], "MODIFY") == 0 && (count == 3 || count == 4)) {
+        command.order.order_id = std::strtoull(tokens[1], &end, 10);
+        if (*end != '\0') {
+            return false;
+        }
+        long quantity = std::strtol(tokens[2], &end, 10);
+        if (*end != '\0' || quantity <= 0 || quantity > INT_MAX) {
+            return false;
+        }
+        command.order.quantity = static_cast<int>(quantity);
+        if (count == 4) {
+            double price = std::strtod(tokens[3], &end);
+            if (*end != '\0' || price <= 0.0) {
+                return false;
+            }
+            if (!try_price_to_ticks(price, tick_size, command.order.price) || command.order.price <= 0) {
+                return false;
+            }
+        }
+        command.type = CommandType::MODIFY;
+        return true;
+    }
+    
+    if (strcasecmp(tokens[0], "AUCTION") == 0 && count == 1) {
+        command.type = CommandType::BEGIN_AUCTION;
+        return true;
+    }
+    
+    if (strcasecmp(tokens[0], "UNCROSS") == 0 && count == 1) {
+        command.type = CommandType::UNCROSS;
+        return true;
+    }
+    
+    if (strcasecmp(tokens[0], "MASSCANCEL") == 0 && count <= 4) {
+        MassCancel filter;
+        if (count == 3 && strcasecmp(tokens[1], "OWNER") == 0) {
+            unsigned long owner = std::strtoul(tokens[2], &end, 10);
+            if (*end != '\0' || owner > UINT16_MAX) {
+                return false;
+            }
+            filter = MassCancel::of_owner(static_cast<uint16_t>(owner));
+        } else if (count >= 2) {
+            Side side;
+            if (strcasecmp(tokens[1], "BUY") == 0) {
+                side = Side::BUY;
+            } else if (strcasecmp(tokens[1], "SELL") == 0) {
+                side = Side::SELL;
+            } else {
+                return false;
+            }
+            filter = MassCancel::of_side(side);
+            if (count == 4) {
+                double low = std::strtod(tokens[2], &end);
+                if (*end != '\0') {
+                    return false;
+                }
+                double high = std::strtod(tokens[3], &end);
+                if (*end != '\0' || low > high) {
+                    return false;
+                }
+                filter = MassCancel::price_range(side, price_to_ticks(low, tick_size), price_to_ticks(high, tick_size));
+            } else if (count == 3) {
+                return false;
+            }
+        }
+        command = Command::mass_cancel(0, filter);
+        return true;
+    }
+    
+    return false;
+}
+
+OrderPipeline::OrderPipeline(const PipelineConfig& config, FillHandler on_fill)
+    : config(config), fill_handler(std::move(on_fill)),
+      matching_engine(nullptr, config.tick_size, config.order_capacity),
+      gateway_in(config.ring_capacity, config.wait_strategy),
+      sequencer_in(config.ring_capacity, config.wait_strategy),
+      matcher_in(config.ring_capacity, config.wait_strategy),
+      publisher_in(config.ring_capacity, config.wait_strategy) {
+}
+
+OrderPipeline::~OrderPipeline() {
+    stop();
+}
+
+void OrderPipeline::start() {
+    if (running) {
+        return;
+    }
+    
+    // Calibrate before the publisher needs the ratio
+    TscClock::ns_per_tick();
+    
+    gateway_in.producer_done.store(false, std::memory_order_relaxed);
+    sequencer_in.producer_done.store(false, std::memory_order_relaxed);
+    matcher_in.producer_done.store(false, std::memory_order_relaxed);
+    publisher_in.producer_done.store(false, std::memory_order_relaxed);
+    
+    publisher_thread = std::thread(&OrderPipeline::run_publisher, this);
+    matcher_thread = std::thread(&OrderPipeline::run_matcher, this);
+    sequencer_thread = std::thread(&OrderPipeline::run_sequencer, this);
+    gateway_thread = std::thread(&OrderPipeline::run_gateway, this);
+    running = true;
+    LOG_INFO("OrderPipeline started with {} wait strategy", wait_strategy_to_string(config.wait_strategy));
+}
+
+void OrderPipeline::stop() {
+    if (!running) {
+        return;
+    }
+    
+    // Each stage drains its ring and then marks the next one done
+    gateway_in.producer_done.store(true, std::memory_order_release);
+    gateway_in.waiter.notify();
+    gateway_thread.join();
+    sequencer_thread.join();
+    matcher_thread.join();
+    publisher_thread.join();
+    running = false;
+}
+
+bool OrderPipeline::submit(const char* text, size_t length) {
+    if (length > MAX_LINE) {
+        LOG_ERROR("Command of {} bytes exceeds the {} byte limit", length, MAX_LINE);
+        return false;
+    }
+    
+    RawMessage message;
+    message.ingress_tsc = TscClock::now();
+    message.length = static_cast<uint32_t>(length);
+    std::memcpy(message.text, text, length);
+    publish(gateway_in, message);
+    submitted_count++;
+    return true;
+}
+
+void OrderPipeline::wait_idle() const {
+    while (completed() + rejected() < submitted_count) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename T>
+void OrderPipeline::publish(Stage<T>& stage, const T& item) {
+    unsigned spins = 0;
+    while (!stage.ring.try_push(item)) {
+        stage.waiter.backoff(spins);
+    }
+    stage.waiter.notify();
+}
+
+template <typename T, typename Handler>
+void OrderPipeline::consume(Stage<T>& stage, Handler&& handle) {
+    T item;
+    unsigned spins = 0;
+    auto ready = [&stage] {
+        return !stage.ring.empty() || stage.producer_done.load(std::memory_order_acquire);
+    };
+    
+    while (true) {
+        if (stage.ring.try_pop(item)) {
+            handle(item);
+            spins = 0;
+            continue;
+        }
+        // The producer's last push is visible once its done flag is
+        if (stage.producer_done.load(std::memory_order_acquire)) {
+            if (!stage.ring.try_pop(item)) {
+                break;
+            }
+            handle(item);
+            continue;
+        }
+        stage.waiter.wait(spins, ready);
+    }
+}
+
+void OrderPipeline::run_gateway() {
+    consume(gateway_in, [this](const RawMessage& message) {
+        StagedCommand staged;
+        staged.ingress_tsc = message.ingress_tsc;
+        if (!parse_command(message.text, message.length, config.tick_size, staged.command)) {
+            rejected_count.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        publish(sequencer_in, staged);
+    });
+    sequencer_in.producer_done.store(true, std::memory_order_release);
+    sequencer_in.waiter.notify();
+}
+
+void OrderPipeline::run_sequencer() {
+    uint64_t sequence = 0;
+    uint64_t next_order_id = 1;
+    consume(sequencer_in, [&](StagedCommand& staged) {
+        Command& command = staged.command;
+        command.sequence = ++sequence;
+        if (command.type == CommandType::ADD || command.type == CommandType::ADD_STOP) {
+            command.order.order_id = next_order_id++;
+            command.order.timestamp = Order::get_current_timestamp();
+        }
+        publish(matcher_in, staged);
+    });
+    matcher_in.producer_done.store(true, std::memory_order_release);
+    matcher_in.waiter.notify();
+}
+
+void OrderPipeline::run_matcher() {
+    OutboundEvent event{};
+    auto forward_fill = [this, &event](const Fill& fill) {
+        event.kind = OutboundEvent::Kind::FILL;
+        event.fill = fill;
+        publish(publisher_in, event);
+    };
+    
+    consume(matcher_in, [&](const StagedCommand& staged) {
+        matching_engine.execute(staged.command, forward_fill);
+        event.kind = OutboundEvent::Kind::DONE;
+        event.ingress_tsc = staged.ingress_tsc;
+        publish(publisher_in, event);
+    });
+    publisher_in.producer_done.store(true, std::memory_order_release);
+    publisher_in.waiter.notify();
+}
+
+void OrderPipeline::run_publisher() {
+    double ns_per_tick = TscClock::ns_per_tick();
+    uint64_t completed = completed_count.load(std::memory_order_relaxed);
+    uint64_t fills = fill_count.load(std::memory_order_relaxed);
+    
+    consume(publisher_in, [&](const OutboundEvent& event) {
+        if (event.kind == OutboundEvent::Kind::FILL) {
+            if (fill_handler) {
+                fill_handler(event.fill);
+            }
+            fill_count.store(++fills, std::memory_order_relaxed);
+            return;
+        }
+        latency_ns.record(static_cast<uint64_t>((TscClock::now() - event.ingress_tsc) * ns_per_tick));
+        completed_count.store(++completed, std::memory_order_release);
+    });
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "command.hpp"
+#include "matching_engine.hpp"
+#include "utils/latency_histogram.hpp"
+#include "utils/spsc_ring.hpp"
+#include "utils/wait_strategy.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Parse one text command ("ADD BUY LIMIT 100.50 200", "ADD SELL MARKET 0 100",
+// "ADD BUY LIMIT 100.50 200 FOK", "CANCEL 12", "MODIFY 12 300", "MODIFY 12 300 100.25",
+// "MASSCANCEL", "MASSCANCEL SELL", "MASSCANCEL BUY 99.50 100.00", "MASSCANCEL OWNER 7",
+// "AUCTION", "UNCROSS")
+// with the same rules as the Order constructor.
+// Leaves sequence, order id and timestamp for the sequencer.
+bool parse_command(const char* text, size_t length, double tick_size, Command& command);
+
+struct PipelineConfig {
+    size_t ring_capacity = 1 << 14;                 // slots per stage-to-stage ring
+    WaitStrategy wait_strategy = WaitStrategy::YIELD;
+    double tick_size = DEFAULT_TICK_SIZE;
+    size_t order_capacity = OrderBook::DEFAULT_ORDER_CAPACITY;
+};
+
+// Four-stage order ingestion pipeline, one thread per stage, connected by
+// bounded SPSC rings:
+//   gateway    parses and validates text commands (rejects stop here)
+//   sequencer  assigns sequence numbers, order ids and arrival timestamps
+//   matcher    only runs MatchingEngine::execute
+//   publisher  hands fills to the fill handler and records end-to-end latency
+// submit() is the single producer and must always be called from one thread.
+class OrderPipeline {
+public:
+    using FillHandler = std::function<void(const Fill&)>;
+    
+    explicit OrderPipeline(const PipelineConfig& config = PipelineConfig(), FillHandler on_fill = nullptr);
+    ~OrderPipeline();
+    
+    OrderPipeline(const OrderPipeline&) = delete;
+    OrderPipeline& operator=(const OrderPipeline&) = delete;
+    
+    void start();
+    
+    // Let every stage drain its input, then join the stage threads
+    void stop();
+    
+    // Copy one text command into the gateway ring; false if it is too long
+    bool submit(const char* text, size_t length);
+    bool submit(const std::string& line) { return submit(line.data(), line.size()); }
+    
+    // Block until every submitted command has been published or rejected
+    void wait_idle() const;
+    
+    uint64_t submitted() const { return submitted_count; }
+    uint64_t completed() const { return completed_count.load(std::memory_order_acquire); }
+    uint64_t rejected() const { return rejected_count.load(std::memory_order_acquire); }
+    uint64_t fills() const { return fill_count.load(std::memory_order_acquire); }
+    
+    // Submit-to-publish latency in nanoseconds; read after wait_idle() or stop()
+    const LatencyHistogram& latency() const { return latency_ns; }
+    
+    // Engine state; read after wait_idle() or stop()
+    const MatchingEngine& engine() const { return matching_engine; }
+
+private:
+    static constexpr size_t MAX_LINE = 48;
+    
+    struct RawMessage {
+        uint64_t ingress_tsc;
+        uint32_t length;
+        char text[MAX_LINE];
+    };
+    
+    struct StagedCommand {
+        uint64_t ingress_tsc;
+        Command command;
+    };
+    
+    struct OutboundEvent {
+        enum class Kind : uint8_t { FILL, DONE };
+        Kind kind;
+        uint64_t ingress_tsc;  // DONE only
+        Fill fill;             // FILL only
+    };
+    
+    // One ring plus the waiter its consumer parks on
+    template <typename T>
+    struct Stage {
+        Stage(size_t capacity, WaitStrategy strategy) : ring(capacity), waiter(strategy) {}
+        SpscRing<T> ring;
+        StageWaiter waiter;
+        std::atomic<bool> producer_done{false};
+    };
+    
+    template <typename T>
+    void publish(Stage<T>& stage, const T& item);
+    
+    template <typename T, typename Handler>
+    void consume(Stage<T>& stage, Handler&& handle);
+    
+    void run_gateway();
+    void run_sequencer();
+    void run_matcher();
+    void run_publisher();
+    
+    PipelineConfig config;
+    FillHandler fill_handler;
+    MatchingEngine matching_engine;
+    
+    Stage<RawMessage> gateway_in;
+    Stage<StagedCommand> sequencer_in;
+    Stage<StagedCommand> matcher_in;
+    Stage<OutboundEvent> publisher_in;
+    
+    std::thread gateway_thread;
+    std::thread sequencer_thread;
+    std::thread matcher_thread;
+    std::thread publisher_thread;
+    bool running = false;
+    
+    // Producer-owned
+    uint64_t submitted_count = 0;
+    
+    // Each written by exactly one stage
+    alignas(64) std::atomic<uint64_t> rejected_count{0};
+    alignas(64) std::atomic<uint64_t> completed_count{0};
+    std::atomic<uint64_t> fill_count{0};
+    LatencyHistogram latency_ns;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// Prices inside the book are integer multiples of a tick size
+using Price = int32_t;
+
+constexpr double DEFAULT_TICK_SIZE = 0.01;
+
+// Rounds to the nearest tick; fails when the price is not finite or its tick
+// count does not fit in a Price
+inline bool try_price_to_ticks(double price, double tick_size, Price& ticks) {
+    double scaled = std::round(price / tick_size);
+    if (!(scaled >= std::numeric_limits<Price>::min() && scaled <= std::numeric_limits<Price>::max())) {
+        return false;
+    }
+    ticks = static_cast<Price>(scaled);
+    return true;
+}
+
+// Unchecked conversion for prices already validated or used only as bounds:
+// out-of-range prices saturate instead of wrapping, and NaN maps to 0
+inline Price price_to_ticks(double price, double tick_size) {
+    double scaled = std::round(price / tick_size);
+    if (scaled >= std::numeric_limits<Price>::max()) {
+        return std::numeric_limits<Price>::max();
+    }
+    if (scaled <= std::numeric_limits<Price>::min()) {
+        return std::numeric_limits<Price>::min();
+    }
+    return std::isnan(scaled) ? 0 : static_cast<Price>(scaled);
+}
+
+inline double ticks_to_price(Price ticks, double tick_size) {
+    // Divide by ticks-per-unit when it is whole so 10050 ticks of 0.01 is exactly 100.50
+    double ticks_per_unit = std::round(1.0 / tick_size);
+    if (ticks_per_unit * tick_size == 1.0) {
+        return static_cast<double>(ticks) / ticks_per_unit;
+    }
+    return static_cast<double>(ticks) * tick_size;
+}
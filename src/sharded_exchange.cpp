@@ -0,0 +1,183 @@
+#include "sharded_exchange.hpp"
+#include "utils/logger.hpp"
+#include "utils/wait_strategy.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+
+// Busy-wait budget before a spinning thread gives up its core
+constexpr unsigned SPINS_BEFORE_YIELD = 1024;
+
+ShardedExchange::ShardedExchange(const ShardedExchangeConfig& config) : config(config) {
+    // ALL_SYMBOLS is the broadcast id, never a book of its own
+    this->config.symbol_count = std::min<size_t>(config.symbol_count, ALL_SYMBOLS);
+    size_t count = config.shard_count;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    count = std::min(count, std::max<size_t>(this->config.symbol_count, 1));
+    
+    shards.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        shards.push_back(std::make_unique<Shard>(config.ring_capacity));
+    }
+}
+
+ShardedExchange::~ShardedExchange() {
+    stop();
+}
+
+void ShardedExchange::start() {
+    if (running) {
+        return;
+    }
+    
+    stopping.store(false, std::memory_order_release);
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i]->worker = std::thread(&ShardedExchange::run_shard, this, i);
+    }
+    
+    // Engines are built on their own worker so their memory is first touched there
+    for (auto& shard : shards) {
+        while (!shard->ready.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+    running = true;
+    LOG_INFO("ShardedExchange started: {} shards, {} symbols", shards.size(), config.symbol_count);
+}
+
+void ShardedExchange::stop() {
+    if (!running) {
+        return;
+    }
+    
+    stopping.store(true, std::memory_order_release);
+    for (auto& shard : shards) {
+        shard->worker.join();
+        shard->ready.store(false, std::memory_order_relaxed);
+    }
+    running = false;
+}
+
+bool ShardedExchange::submit(const Command& command) {
+    uint16_t symbol = command.order.symbol_id;
+    if (symbol == ALL_SYMBOLS && command.type == CommandType::MASS_CANCEL) {
+        for (auto& shard : shards) {
+            push(*shard, command);
+        }
+        return true;
+    }
+    if (symbol >= config.symbol_count) {
+        LOG_ERROR("Unknown symbol {} for order {}", symbol, command.order.order_id);
+        return false;
+    }
+    
+    push(*shards[shard_of(symbol)], command);
+    return true;
+}
+
+void ShardedExchange::push(Shard& shard, const Command& command) {
+    for (unsigned spins = 0; !shard.inbox.try_push(command); ++spins) {
+        if (spins < SPINS_BEFORE_YIELD) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    shard.submitted++;
+}
+
+void ShardedExchange::wait_idle() const {
+    for (const auto& shard : shards) {
+        while (shard->processed.load(std::memory_order_acquire) < shard->submitted) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+ShardStats ShardedExchange::shard_stats(size_t shard) const {
+    const Shard& s = *shards[shard];
+    ShardStats stats;
+    stats.commands = s.processed.load(std::memory_order_acquire);
+    stats.fills = s.fills.load(std::memory_order_relaxed);
+    stats.symbols = s.engines.size();
+    return stats;
+}
+
+uint64_t ShardedExchange::total_fills() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        total += shard_stats(i).fills;
+    }
+    return total;
+}
+
+const MatchingEngine& ShardedExchange::engine_for(uint16_t symbol_id) const {
+    if (symbol_id >= config.symbol_count) {
+        throw std::out_of_range("Symbol id is outside the configured symbol range");
+    }
+    return *shards[shard_of(symbol_id)]->engines[symbol_id / shards.size()];
+}
+
+void ShardedExchange::run_shard(size_t index) {
+    Shard& shard = *shards[index];
+    size_t stride = shards.size();
+    
+    if (config.pin_threads) {
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            LOG_INFO("Could not pin shard {} to cpu {}", index, index % cpus);
+        }
+    }
+    
+    // Books survive a stop/start cycle; only the first start builds them
+    for (size_t symbol = index + shard.engines.size() * stride; symbol < config.symbol_count; symbol += stride) {
+        shard.engines.push_back(
+            std::make_unique<MatchingEngine>(nullptr, config.tick_size, config.orders_per_symbol));
+    }
+    shard.ready.store(true, std::memory_order_release);
+    
+    constexpr size_t BATCH = 64;
+    uint64_t processed = shard.processed.load(std::memory_order_relaxed);
+    uint64_t fills = shard.fills.load(std::memory_order_relaxed);
+    auto count_fill = [&fills](const Fill&) { fills++; };
+    unsigned idle_spins = 0;
+    Command command;
+    
+    while (true) {
+        size_t batch = 0;
+        while (batch < BATCH && shard.inbox.try_pop(command)) {
+            if (command.order.symbol_id == ALL_SYMBOLS) {
+                for (auto& engine : shard.engines) {
+                    engine->execute(command, count_fill);
+                }
+            } else {
+                shard.engines[command.order.symbol_id / stride]->execute(command, count_fill);
+            }
+            batch++;
+        }
+        
+        // Progress is published once per batch rather than per command
+        if (batch > 0) {
+            processed += batch;
+            shard.fills.store(fills, std::memory_order_relaxed);
+            shard.processed.store(processed, std::memory_order_release);
+            idle_spins = 0;
+            continue;
+        }
+        
+        if (stopping.load(std::memory_order_acquire) && shard.inbox.empty()) {
+            break;
+        }
+        
+        if (++idle_spins < SPINS_BEFORE_YIELD) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "command.hpp"
+#include "matching_engine.hpp"
+#include "utils/spsc_ring.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct ShardedExchangeConfig {
+    size_t shard_count = 0;             // worker threads; 0 = one per hardware thread
+    size_t symbol_count = 1024;         // valid symbol ids are [0, symbol_count), below ALL_SYMBOLS
+    size_t ring_capacity = 1 << 16;     // commands queued per shard
+    size_t orders_per_symbol = 256;     // initial order pool per book
+    double tick_size = DEFAULT_TICK_SIZE;
+    bool pin_threads = true;            // pin shard i to CPU i % hardware threads
+};
+
+struct ShardStats {
+    uint64_t commands = 0;
+    uint64_t fills = 0;
+    size_t symbols = 0;
+};
+
+// Multi-instrument exchange. Symbols are partitioned across worker threads
+// (symbol % shard_count); each worker owns the engines for its symbols and is
+// fed through its own SPSC ring, so matching never touches shared state.
+// submit() is the single producer and must always be called from one thread.
+class ShardedExchange {
+public:
+    explicit ShardedExchange(const ShardedExchangeConfig& config = ShardedExchangeConfig());
+    ~ShardedExchange();
+    
+    ShardedExchange(const ShardedExchange&) = delete;
+    ShardedExchange& operator=(const ShardedExchange&) = delete;
+    
+    // Spawn the workers; returns once every shard has built its engines
+    void start();
+    
+    // Drain every queue, then join the workers
+    void stop();
+    
+    // Route a command to the shard owning its symbol; waits while that
+    // shard's queue is full. Rejects unknown symbols. A MASS_CANCEL for
+    // ALL_SYMBOLS goes to every shard, which applies it to each of its books.
+    bool submit(const Command& command);
+    
+    // Block until every submitted command has been applied
+    void wait_idle() const;
+    
+    size_t shard_count() const { return shards.size(); }
+    size_t shard_of(uint16_t symbol_id) const { return symbol_id % shards.size(); }
+    
+    ShardStats shard_stats(size_t shard) const;
+    uint64_t total_fills() const;
+    
+    // Book of one symbol; only safe to inspect after wait_idle() or stop().
+    // Throws std::out_of_range for ids at or past symbol_count.
+    const MatchingEngine& engine_for(uint16_t symbol_id) const;
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(size_t ring_capacity) : inbox(ring_capacity) {}
+        
+        SpscRing<Command> inbox;
+        std::vector<std::unique_ptr<MatchingEngine>> engines;   // indexed by symbol / shard_count
+        std::thread worker;
+        
+        // Written only by the worker
+        alignas(64) std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> fills{0};
+        std::atomic<bool> ready{false};
+        
+        // Written only by the producer
+        alignas(64) uint64_t submitted = 0;
+    };
+    
+    void run_shard(size_t index);
+    void push(Shard& shard, const Command& command);
+    
+    ShardedExchangeConfig config;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping{false};
+    bool running = false;
+};
@@ -0,0 +1,190 @@
+#include "snapshot.hpp"
+#include "order_flow.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t SNAPSHOT_CHUNK = 4096;
+
+bool file_exists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+}  // namespace
+
+bool save_snapshot(const MatchingEngine& engine, uint64_t last_sequence, const std::string& path) {
+    const OrderBook& book = engine.get_order_book();
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Cannot open snapshot {} for writing", temp_path);
+        return false;
+    }
+    
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.record_size = sizeof(Order);
+    header.last_sequence = last_sequence;
+    header.order_count = book.total_orders();
+    header.fill_count = engine.total_fills();
+    header.total_volume = engine.total_volume();
+    header.tick_size = book.tick_size();
+    header.stop_count = engine.get_stop_book().size();
+    header.last_trade_price = engine.last_trade_price();
+    header.auction_phase = engine.in_auction() ? 1 : 0;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    
+    std::vector<Order> chunk;
+    chunk.reserve(SNAPSHOT_CHUNK);
+    auto write_chunk = [&] {
+        if (ok && !chunk.empty() && std::fwrite(chunk.data(), sizeof(Order), chunk.size(), file) != chunk.size()) {
+            ok = false;
+        }
+        chunk.clear();
+    };
+    for (bool buy_side : {true, false}) {
+        book.for_each_order(buy_side, [&](const Order& order) {
+            chunk.push_back(order);
+            if (chunk.size() == SNAPSHOT_CHUNK) {
+                write_chunk();
+            }
+        });
+    }
+    write_chunk();
+    
+    for (bool buy_side : {true, false}) {
+        engine.get_stop_book().for_each_stop(buy_side, [&](const Order& order, Price trigger_price) {
+            SnapshotStop stop{order, trigger_price};
+            if (ok && std::fwrite(&stop, sizeof(stop), 1, file) != 1) {
+                ok = false;
+            }
+        });
+    }
+    
+    ok = ok && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (std::fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Cannot write snapshot {}", path);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    LOG_INFO("Wrote snapshot of {} orders and {} stops at sequence {} to {}", header.order_count,
+             header.stop_count, last_sequence, path);
+    return true;
+}
+
+bool load_snapshot(const std::string& path, MatchingEngine& engine, uint64_t& last_sequence) {
+    OrderBook& book = engine.get_order_book();
+    if (!book.empty() || !engine.get_stop_book().empty()) {
+        LOG_ERROR("Snapshot {} must be loaded into an empty engine", path);
+        return false;
+    }
+    
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        LOG_ERROR("Cannot open snapshot {}", path);
+        return false;
+    }
+    
+    SnapshotHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.record_size != sizeof(Order)) {
+        LOG_ERROR("{} is not a version {} snapshot", path, SNAPSHOT_VERSION);
+        std::fclose(file);
+        return false;
+    }
+    if (header.tick_size != book.tick_size()) {
+        LOG_ERROR("Snapshot {} has tick size {}, engine uses {}", path, header.tick_size, book.tick_size());
+        std::fclose(file);
+        return false;
+    }
+    
+    std::vector<Order> chunk(SNAPSHOT_CHUNK);
+    uint64_t remaining = header.order_count;
+    while (remaining > 0) {
+        size_t wanted = static_cast<size_t>(std::min<uint64_t>(remaining, SNAPSHOT_CHUNK));
+        if (std::fread(chunk.data(), sizeof(Order), wanted, file) != wanted) {
+            LOG_ERROR("Snapshot {} is truncated: {} of {} orders missing", path, remaining, header.order_count);
+            std::fclose(file);
+            return false;
+        }
+        for (size_t i = 0; i < wanted; ++i) {
+            book.add_order(chunk[i]);
+        }
+        remaining -= wanted;
+    }
+    
+    // Stops go straight into the stop book; nothing fires while loading
+    for (uint64_t i = 0; i < header.stop_count; ++i) {
+        SnapshotStop stop;
+        if (std::fread(&stop, sizeof(stop), 1, file) != 1) {
+            LOG_ERROR("Snapshot {} is truncated: {} of {} stops missing", path, header.stop_count - i,
+                      header.stop_count);
+            std::fclose(file);
+            return false;
+        }
+        engine.get_stop_book().add(stop.order, stop.trigger_price);
+    }
+    std::fclose(file);
+    
+    engine.restore_statistics(header.fill_count, header.total_volume, static_cast<Price>(header.last_trade_price));
+    if (header.auction_phase) {
+        engine.begin_auction();     // the book may be crossed until the uncross
+    }
+    last_sequence = header.last_sequence;
+    return true;
+}
+
+bool recover_engine(const std::string& snapshot_path, const std::string& journal_path,
+                    MatchingEngine& engine, RecoveryStats& stats) {
+    stats = RecoveryStats();
+    
+    auto start = std::chrono::steady_clock::now();
+    if (!snapshot_path.empty() && file_exists(snapshot_path)) {
+        if (!load_snapshot(snapshot_path, engine, stats.snapshot_sequence)) {
+            return false;
+        }
+        stats.snapshot_orders = engine.get_order_book().total_orders();
+    }
+    stats.last_sequence = stats.snapshot_sequence;
+    auto loaded = std::chrono::steady_clock::now();
+    stats.snapshot_seconds = std::chrono::duration<double>(loaded - start).count();
+    
+    if (!journal_path.empty() && file_exists(journal_path)) {
+        FlowReader journal;
+        if (!journal.open(journal_path)) {
+            return false;
+        }
+        if (journal.tick_size() != engine.get_order_book().tick_size()) {
+            LOG_ERROR("Journal {} has tick size {}, engine uses {}", journal_path, journal.tick_size(),
+                      engine.get_order_book().tick_size());
+            return false;
+        }
+        stats.journal_records = journal.size();
+        
+        // Records already folded into the snapshot are skipped, not re-applied
+        for (const Command& command : journal) {
+            if (command.sequence <= stats.snapshot_sequence) {
+                continue;
+            }
+            engine.execute(command, [](const Fill&) {});
+            stats.replayed++;
+            stats.last_sequence = command.sequence;
+        }
+    }
+    stats.replay_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loaded).count();
+    
+    LOG_INFO("Recovered {} snapshot orders and {} journal commands up to sequence {}",
+             stats.snapshot_orders, stats.replayed, stats.last_sequence);
+    return true;
+}
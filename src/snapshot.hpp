@@ -0,0 +1,58 @@
+#pragma once
+
+#include "matching_engine.hpp"
+#include <cstdint>
+#include <string>
+
+// Snapshot layout: one SnapshotHeader followed by order_count raw Order records,
+// bids then asks, each side from the best level outwards and FIFO within a
+// level, so re-adding them in file order rebuilds the same queues. Then
+// stop_count SnapshotStop records, buy stops then sell stops in firing order.
+struct SnapshotHeader {
+    char magic[8];          // "LOBSNAP"
+    uint32_t version;
+    uint32_t record_size;   // sizeof(Order) when written
+    uint64_t last_sequence; // last command applied before the snapshot
+    uint64_t order_count;
+    uint64_t fill_count;
+    double total_volume;
+    double tick_size;
+    uint64_t stop_count;
+    int64_t last_trade_price;   // ticks, what pending stops are compared against
+    uint8_t auction_phase;      // 1 when taken during a call auction
+    uint8_t reserved[7];
+};
+
+static_assert(sizeof(SnapshotHeader) == 80, "Snapshot header is fixed-width");
+
+struct SnapshotStop {
+    Order order;
+    Price trigger_price;
+};
+
+static_assert(sizeof(SnapshotStop) == 40, "Snapshot stop record is fixed-width");
+
+constexpr char SNAPSHOT_MAGIC[8] = "LOBSNAP";
+constexpr uint32_t SNAPSHOT_VERSION = 5;      // 2: Order carries a time in force, 3: pending stops, 4: owners,
+                                              // 5: auction phase
+
+// Writes to `path`.tmp, syncs and renames, so `path` is always a whole snapshot
+bool save_snapshot(const MatchingEngine& engine, uint64_t last_sequence, const std::string& path);
+
+// Loads into an empty engine with the snapshot's tick size
+bool load_snapshot(const std::string& path, MatchingEngine& engine, uint64_t& last_sequence);
+
+struct RecoveryStats {
+    uint64_t snapshot_orders = 0;
+    uint64_t snapshot_sequence = 0;
+    uint64_t journal_records = 0;
+    uint64_t replayed = 0;          // journal records newer than the snapshot
+    uint64_t last_sequence = 0;
+    double snapshot_seconds = 0.0;
+    double replay_seconds = 0.0;
+};
+
+// Startup path: latest snapshot (if any), then only the journal tail after it.
+// Either file may be missing; a missing snapshot means replaying the whole journal.
+bool recover_engine(const std::string& snapshot_path, const std::string& journal_path,
+                    MatchingEngine& engine, RecoveryStats& stats);
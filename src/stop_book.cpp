@@ -0,0 +1,69 @@
+#include "stop_book.hpp"
+#include "utils/logger.hpp"
+
+bool StopBook::add(const Order& order, Price trigger_price) {
+    if (contains(order.order_id)) {
+        LOG_ERROR("Duplicate stop order id {}", order.order_id);
+        return false;
+    }
+    
+    // Equal keys go after existing ones, which keeps FIFO within a trigger price
+    TriggerMap& stops = side(order.is_buy());
+    index.emplace(order.order_id, stops.emplace(trigger_price, order));
+    return true;
+}
+
+bool StopBook::cancel(uint64_t order_id) {
+    auto it = index.find(order_id);
+    if (it == index.end()) {
+        return false;
+    }
+    
+    TriggerMap::iterator entry = it->second;
+    side(entry->second.is_buy()).erase(entry);
+    index.erase(it);
+    LOG_INFO("Cancelled stop order {}", order_id);
+    return true;
+}
+
+size_t StopBook::cancel_matching(const MassCancel& filter) {
+    if (filter.scope == MassCancelScope::ALL) {
+        size_t cancelled = index.size();
+        buy_stops.clear();
+        sell_stops.clear();
+        index.clear();
+        return cancelled;
+    }
+    
+    size_t cancelled = 0;
+    for (bool buy_side : {true, false}) {
+        TriggerMap& stops = side(buy_side);
+        for (auto entry = stops.begin(); entry != stops.end();) {
+            if (filter.matches(entry->second, false)) {
+                index.erase(entry->second.order_id);
+                entry = stops.erase(entry);
+                cancelled++;
+            } else {
+                ++entry;
+            }
+        }
+    }
+    return cancelled;
+}
+
+bool StopBook::pop_triggered(Price last_price, Order& order) {
+    TriggerMap* stops = nullptr;
+    if (!buy_stops.empty() && buy_stops.begin()->first <= last_price) {
+        stops = &buy_stops;
+    } else if (!sell_stops.empty() && sell_stops.begin()->first >= last_price) {
+        stops = &sell_stops;
+    } else {
+        return false;
+    }
+    
+    auto entry = stops->begin();
+    order = entry->second;
+    index.erase(order.order_id);
+    stops->erase(entry);
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "mass_cancel.hpp"
+#include "order.hpp"
+#include "price.hpp"
+#include <map>
+#include <unordered_map>
+
+// Pending stop and stop-limit orders, held off the book until the last trade
+// price reaches their trigger. Each side is kept sorted by trigger price in the
+// order its stops fire (buy stops lowest first, sell stops highest first), so
+// finding the triggered ones never looks at a stop that is still out of reach.
+class StopBook {
+public:
+    // `order` is what enters the book once triggered: a market order for a
+    // stop, a limit order for a stop-limit. False for a duplicate order id.
+    bool add(const Order& order, Price trigger_price);
+    bool cancel(uint64_t order_id);
+    
+    // Withdraws every stop `filter` selects and returns how many
+    size_t cancel_matching(const MassCancel& filter);
+    bool contains(uint64_t order_id) const { return index.count(order_id) != 0; }
+    
+    // Removes the next stop `last_price` has triggered: buy stops with a trigger
+    // at or below it, then sell stops with a trigger at or above it, nearest
+    // trigger first and FIFO within one trigger price
+    bool pop_triggered(Price last_price, Order& order);
+    
+    // Pending stops on one side in firing order
+    template <typename Visitor>
+    void for_each_stop(bool buy_side, Visitor&& visit) const;
+    
+    size_t size() const { return index.size(); }
+    size_t side_size(bool buy_side) const { return side(buy_side).size(); }
+    bool empty() const { return index.empty(); }
+
+private:
+    // Ascending for buy stops, descending for sell stops; one type keeps the
+    // iterators of both sides interchangeable in the index
+    struct FiringOrder {
+        bool descending;
+        bool operator()(Price a, Price b) const { return descending ? a > b : a < b; }
+    };
+    
+    using TriggerMap = std::multimap<Price, Order, FiringOrder>;
+    
+    TriggerMap buy_stops{FiringOrder{false}};
+    TriggerMap sell_stops{FiringOrder{true}};
+    
+    // Order ID to its trigger entry for constant-time cancellation
+    std::unordered_map<uint64_t, TriggerMap::iterator> index;
+    
+    TriggerMap& side(bool buy_side) { return buy_side ? buy_stops : sell_stops; }
+    const TriggerMap& side(bool buy_side) const { return buy_side ? buy_stops : sell_stops; }
+};
+
+template <typename Visitor>
+void StopBook::for_each_stop(bool buy_side, Visitor&& visit) const {
+    for (const auto& [trigger_price, order] : side(buy_side)) {
+        visit(order, trigger_price);
+    }
+}
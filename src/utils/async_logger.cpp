@@ -0,0 +1,227 @@
+#include "async_logger.hpp"
+#include "logger.hpp"
+#include "tsc_clock.hpp"
+#include <cinttypes>
+
+std::atomic<AsyncLogger*> AsyncLogger::active{nullptr};
+std::atomic<uint64_t> AsyncLogger::generation{0};
+std::atomic<uint32_t> AsyncLogger::in_flight{0};
+
+std::string format_log_record(const LogRecord& record) {
+    if (!record.format) {
+        return std::string(record.text, record.text_length);
+    }
+    
+    std::string out;
+    out.reserve(96);
+    size_t next_arg = 0;
+    char number[32];
+    
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] != '{' || p[1] != '}' || next_arg >= record.arg_count) {
+            out += *p;
+            continue;
+        }
+        
+        uint64_t raw = record.args[next_arg];
+        switch (record.arg_kinds[next_arg]) {
+            case LogRecord::ArgKind::INT:
+                std::snprintf(number, sizeof(number), "%" PRId64, static_cast<int64_t>(raw));
+                out += number;
+                break;
+            case LogRecord::ArgKind::UINT:
+                std::snprintf(number, sizeof(number), "%" PRIu64, raw);
+                out += number;
+                break;
+            case LogRecord::ArgKind::DOUBLE: {
+                double value;
+                std::memcpy(&value, &raw, sizeof(value));
+                std::snprintf(number, sizeof(number), "%g", value);
+                out += number;
+                break;
+            }
+            case LogRecord::ArgKind::TEXT:
+                out.append(record.text + (raw >> 32), raw & 0xffffffffu);
+                break;
+        }
+        next_arg++;
+        ++p; // skip the closing brace
+    }
+    return out;
+}
+
+AsyncLogger::AsyncLogger(const AsyncLoggerConfig& config)
+    : config(config), id(++generation), start_tsc(TscClock::now()),
+      start_wall(std::chrono::system_clock::now()) {
+}
+
+void AsyncLogger::start(const AsyncLoggerConfig& config) {
+    if (running()) {
+        return;
+    }
+    
+    // Calibrate before the first record so the worker never stalls on it
+    TscClock::ns_per_tick();
+    
+    AsyncLogger* logger = new AsyncLogger(config);
+    logger->worker = std::thread(&AsyncLogger::run, logger);
+    active.store(logger, std::memory_order_release);
+}
+
+void AsyncLogger::stop() {
+    AsyncLogger* logger = active.exchange(nullptr, std::memory_order_seq_cst);
+    if (!logger) {
+        return;
+    }
+    
+    // The worker drains every ring and waits out producers that loaded the
+    // pointer before it was cleared, so once it joins nothing can touch logger
+    logger->stopping.store(true, std::memory_order_release);
+    logger->worker.join();
+    std::fflush(logger->config.sink);
+    delete logger;
+}
+
+bool AsyncLogger::submit(const LogRecord& record) {
+    // Announce the producer before loading the pointer: either stop() has not
+    // cleared it yet and its worker will wait for us, or we see null here
+    in_flight.fetch_add(1, std::memory_order_seq_cst);
+    AsyncLogger* logger = active.load(std::memory_order_seq_cst);
+    if (!logger) {
+        in_flight.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+    
+    bool accepted = true;
+    ProducerRing* producer = logger->ring_for_this_thread();
+    if (!producer->ring.try_push(record)) {
+        if (logger->config.overflow == OverflowPolicy::DROP) {
+            producer->dropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Once stop() has begun the record falls back to a synchronous write
+            while (!producer->ring.try_push(record)) {
+                if (logger->stopping.load(std::memory_order_acquire)) {
+                    accepted = false;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+    in_flight.fetch_sub(1, std::memory_order_release);
+    return accepted;
+}
+
+void AsyncLogger::flush() {
+    AsyncLogger* logger = active.load(std::memory_order_acquire);
+    if (!logger) {
+        return;
+    }
+    
+    std::vector<std::pair<ProducerRing*, uint64_t>> targets;
+    {
+        std::lock_guard<std::mutex> lock(logger->rings_mutex);
+        for (auto& producer : logger->rings) {
+            targets.emplace_back(producer.get(), producer->ring.pushed());
+        }
+    }
+    
+    for (auto& [producer, target] : targets) {
+        while (producer->written.load(std::memory_order_acquire) < target) {
+            std::this_thread::sleep_for(logger->config.idle_sleep);
+        }
+    }
+}
+
+uint64_t AsyncLogger::dropped() {
+    AsyncLogger* logger = active.load(std::memory_order_acquire);
+    if (!logger) {
+        return 0;
+    }
+    
+    std::lock_guard<std::mutex> lock(logger->rings_mutex);
+    uint64_t total = 0;
+    for (auto& producer : logger->rings) {
+        total += producer->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+AsyncLogger::ProducerRing* AsyncLogger::ring_for_this_thread() {
+    // Cache keyed by logger generation so a restarted logger hands out fresh rings
+    thread_local uint64_t cached_id = 0;
+    thread_local ProducerRing* cached_ring = nullptr;
+    if (cached_id == id) {
+        return cached_ring;
+    }
+    
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    rings.push_back(std::make_unique<ProducerRing>(config.ring_capacity));
+    cached_ring = rings.back().get();
+    cached_id = id;
+    return cached_ring;
+}
+
+void AsyncLogger::run() {
+    std::string batch;
+    batch.reserve(1 << 16);
+    
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (!drain_once(batch)) {
+            std::this_thread::sleep_for(config.idle_sleep);
+        }
+    }
+    
+    // Flush-on-shutdown: keep draining until every ring is empty and no
+    // producer is still pushing. The count is read before each pass, so the
+    // last pass runs after the last push.
+    for (;;) {
+        bool quiesced = in_flight.load(std::memory_order_seq_cst) == 0;
+        if (!drain_once(batch) && quiesced) {
+            break;
+        }
+    }
+}
+
+bool AsyncLogger::drain_once(std::string& batch) {
+    std::vector<ProducerRing*> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        snapshot.reserve(rings.size());
+        for (auto& producer : rings) {
+            snapshot.push_back(producer.get());
+        }
+    }
+    
+    bool drained = false;
+    LogRecord record;
+    double ns_per_tick = TscClock::ns_per_tick();
+    
+    for (ProducerRing* producer : snapshot) {
+        batch.clear();
+        while (batch.size() < (1 << 16) && producer->ring.try_pop(record)) {
+            auto offset = std::chrono::nanoseconds(static_cast<int64_t>(
+                static_cast<double>(record.tsc - start_tsc) * ns_per_tick));
+            auto wall = start_wall + std::chrono::duration_cast<std::chrono::system_clock::duration>(offset);
+            
+            batch += '[';
+            batch += Logger::format_timestamp(wall);
+            batch += "] [";
+            batch += Logger::level_to_string(record.level);
+            batch += "] ";
+            batch += format_log_record(record);
+            batch += '\n';
+        }
+        
+        if (batch.empty()) {
+            continue;
+        }
+        
+        std::fwrite(batch.data(), 1, batch.size(), config.sink);
+        std::fflush(config.sink);
+        producer->written.store(producer->ring.popped(), std::memory_order_release);
+        drained = true;
+    }
+    
+    return drained;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "log_record.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class OverflowPolicy {
+    DROP,   // discard the record and count it
+    BLOCK   // spin until the background thread frees a slot
+};
+
+struct AsyncLoggerConfig {
+    size_t ring_capacity = 8192;                  // records per producing thread
+    OverflowPolicy overflow = OverflowPolicy::DROP;
+    std::FILE* sink = stderr;
+    std::chrono::microseconds idle_sleep{200};    // back-off when every ring is empty
+};
+
+// Background log writer. Each producing thread gets its own SPSC ring of
+// binary LogRecords; a single background thread drains the rings, formats the
+// records and writes them in batches. While it runs, the LOG_* macros route
+// through submit() instead of writing synchronously.
+class AsyncLogger {
+public:
+    // Start the backend and route LOG_* through it
+    static void start(const AsyncLoggerConfig& config = AsyncLoggerConfig());
+    
+    // Drain every ring, write everything out and return to synchronous logging.
+    // Producers may still be logging: the logger is freed only after those
+    // already inside submit() have left, and later records go out synchronously.
+    static void stop();
+    
+    static bool running() { return active.load(std::memory_order_acquire) != nullptr; }
+    
+    // Hot path: copy the record into the calling thread's ring
+    static bool submit(const LogRecord& record);
+    
+    // Block until every record submitted so far has been written
+    static void flush();
+    
+    // Records discarded under OverflowPolicy::DROP since start()
+    static uint64_t dropped();
+
+private:
+    using Ring = SpscRing<LogRecord>;
+    
+    struct ProducerRing {
+        explicit ProducerRing(size_t capacity) : ring(capacity) {}
+        Ring ring;
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+    
+    explicit AsyncLogger(const AsyncLoggerConfig& config);
+    
+    ProducerRing* ring_for_this_thread();
+    void run();
+    bool drain_once(std::string& batch);
+    
+    static std::atomic<AsyncLogger*> active;
+    static std::atomic<uint64_t> generation;
+    static std::atomic<uint32_t> in_flight;       // producers inside submit()
+    
+    AsyncLoggerConfig config;
+    uint64_t id;
+    uint64_t start_tsc;
+    std::chrono::system_clock::time_point start_wall;
+    
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<ProducerRing>> rings;
+    
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
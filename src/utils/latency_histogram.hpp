@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// Fixed-size log-linear histogram: values below 16 are exact, larger values
+// land in one of 16 sub-buckets per power of two (about 6% resolution).
+// Recording is a couple of shifts and an increment, with no allocation.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    
+    void record(uint64_t value) {
+        counts[bucket_index(value)]++;
+        total++;
+        sum += value;
+        if (value > max_value) {
+            max_value = value;
+        }
+        if (value < min_value) {
+            min_value = value;
+        }
+    }
+    
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        max_value = other.max_value > max_value ? other.max_value : max_value;
+        min_value = other.min_value < min_value ? other.min_value : min_value;
+    }
+    
+    void reset() {
+        *this = LatencyHistogram();
+    }
+    
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+    uint64_t min() const { return total ? min_value : 0; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+    
+    // Upper bound of the bucket holding the q-th quantile (q in [0, 1])
+    uint64_t percentile(double q) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * total);
+        rank = rank >= total ? total - 1 : rank;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                uint64_t upper = bucket_upper(i);
+                return upper < max_value ? upper : max_value;
+            }
+        }
+        return max_value;
+    }
+    
+    // Visit non-empty buckets in ascending order as (lower, upper, count)
+    template <typename Visitor>
+    void for_each_bucket(Visitor&& visit) const {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            if (counts[i]) {
+                visit(bucket_lower(i), bucket_upper(i), counts[i]);
+            }
+        }
+    }
+
+private:
+    static size_t bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        int shift = exponent - SUB_BUCKET_BITS;
+        uint64_t sub = (value >> shift) - SUB_BUCKETS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + sub);
+    }
+    
+    static uint64_t bucket_lower(size_t index) {
+        size_t block = index / SUB_BUCKETS;
+        if (block == 0) {
+            return index;
+        }
+        return (SUB_BUCKETS + index % SUB_BUCKETS) << (block - 1);
+    }
+    
+    static uint64_t bucket_upper(size_t index) {
+        size_t block = index / SUB_BUCKETS;
+        if (block == 0) {
+            return index;
+        }
+        return bucket_lower(index) + ((uint64_t(1) << (block - 1)) - 1);
+    }
+    
+    std::array<uint64_t, BUCKET_COUNT> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max_value = 0;
+    uint64_t min_value = std::numeric_limits<uint64_t>::max();
+};
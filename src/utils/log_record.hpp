@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+enum class LogLevel {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_ERROR = 2,
+    LOG_OFF = 3     // runtime level only: silences every statement
+};
+
+// Fixed-size binary log entry. The hot path only copies the format pointer
+// (a string literal, which doubles as the format id), the raw arguments and a
+// TSC timestamp; turning it into text is left to whoever drains the record.
+struct LogRecord {
+    static constexpr size_t MAX_ARGS = 8;
+    static constexpr size_t TEXT_CAPACITY = 160;
+    
+    enum class ArgKind : uint8_t {
+        INT,
+        UINT,
+        DOUBLE,
+        TEXT    // copied into `text`; the argument holds offset << 32 | length
+    };
+    
+    uint64_t tsc;
+    const char* format;     // nullptr when `text` holds a preformatted message
+    LogLevel level;
+    uint8_t arg_count;
+    uint16_t text_length;
+    ArgKind arg_kinds[MAX_ARGS];
+    uint64_t args[MAX_ARGS];
+    char text[TEXT_CAPACITY];
+    
+    // Preformatted message (the original LOG_*(std::string) form)
+    void set_message(LogLevel lvl, uint64_t timestamp, const std::string& msg) {
+        tsc = timestamp;
+        format = nullptr;
+        level = lvl;
+        arg_count = 0;
+        text_length = 0;
+        append_text(msg.data(), msg.size());
+    }
+    
+    // Format string with "{}" placeholders plus arguments captured by value
+    template <typename... Args>
+    void set_format(LogLevel lvl, uint64_t timestamp, const char* fmt, const Args&... values) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "Too many log arguments");
+        tsc = timestamp;
+        format = fmt;
+        level = lvl;
+        arg_count = 0;
+        text_length = 0;
+        (add_arg(values), ...);
+    }
+
+private:
+    template <typename T>
+    void add_arg(const T& value) {
+        if constexpr (std::is_floating_point<T>::value) {
+            arg_kinds[arg_count] = ArgKind::DOUBLE;
+            double as_double = static_cast<double>(value);
+            std::memcpy(&args[arg_count], &as_double, sizeof(as_double));
+        } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            arg_kinds[arg_count] = ArgKind::INT;
+            args[arg_count] = static_cast<uint64_t>(static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral<T>::value) {
+            arg_kinds[arg_count] = ArgKind::UINT;
+            args[arg_count] = static_cast<uint64_t>(value);
+        } else if constexpr (std::is_same<T, std::string>::value) {
+            add_text_arg(value.data(), value.size());
+            return;
+        } else {
+            static_assert(std::is_convertible<T, const char*>::value, "Unsupported log argument type");
+            const char* str = value;
+            add_text_arg(str, std::strlen(str));
+            return;
+        }
+        arg_count++;
+    }
+    
+    void add_text_arg(const char* data, size_t length) {
+        uint64_t offset = text_length;
+        size_t copied = append_text(data, length);
+        arg_kinds[arg_count] = ArgKind::TEXT;
+        args[arg_count] = (offset << 32) | copied;
+        arg_count++;
+    }
+    
+    size_t append_text(const char* data, size_t length) {
+        size_t copied = std::min(length, TEXT_CAPACITY - text_length);
+        std::memcpy(text + text_length, data, copied);
+        text_length = static_cast<uint16_t>(text_length + copied);
+        return copied;
+    }
+};
+
+static_assert(std::is_trivially_copyable<LogRecord>::value, "LogRecord must stay trivially copyable");
+
+// Expand a record into its message text (without timestamp or level prefix)
+std::string format_log_record(const LogRecord& record);
@@ -3,29 +3,45 @@
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <ctime>
+#include <cstdio>
+#include "log_record.hpp"
+#include "async_logger.hpp"
+#include "tsc_clock.hpp"
 
-enum class LogLevel {
-    LOG_DEBUG = 0,
-    LOG_INFO = 1,
-    LOG_ERROR = 2
-};
+// Compile-time floor: statements below it are removed entirely, message
+// construction included (the message only survives inside an unevaluated
+// sizeof). 0 = DEBUG, 1 = INFO, 2 = ERROR, 3 = no logging.
+#ifndef LOB_MIN_LOG_LEVEL
+#define LOB_MIN_LOG_LEVEL 0
+#endif
 
 class Logger {
 public:
     static LogLevel current_level;
     
     static std::string get_timestamp() {
-        auto now = std::chrono::system_clock::now();
+        return format_timestamp(std::chrono::system_clock::now());
+    }
+    
+    static std::string format_timestamp(std::chrono::system_clock::time_point now) {
         auto time_t = std::chrono::system_clock::to_time_t(now);
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
             now.time_since_epoch()) % 1000;
         
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-        ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-        return ss.str();
+        // Calendar formatting only happens when the second rolls over
+        thread_local std::time_t cached_second = -1;
+        thread_local char cached_prefix[32];
+        if (time_t != cached_second) {
+            std::tm local_tm;
+            localtime_r(&time_t, &local_tm);
+            std::strftime(cached_prefix, sizeof(cached_prefix), "%Y-%m-%d %H:%M:%S", &local_tm);
+            cached_second = time_t;
+        }
+        
+        char buffer[40];
+        std::snprintf(buffer, sizeof(buffer), "%s.%03d", cached_prefix, static_cast<int>(ms.count()));
+        return buffer;
     }
     
     static std::string level_to_string(LogLevel level) {
@@ -36,20 +52,78 @@ public:
             default: return "UNKNOWN";
         }
     }
+    
+    // Assemble the whole line first so it reaches stderr in one write
+    static void write(LogLevel level, const std::string& msg) {
+        std::string line;
+        line.reserve(msg.size() + 40);
+        line += '[';
+        line += get_timestamp();
+        line += "] [";
+        line += level_to_string(level);
+        line += "] ";
+        line += msg;
+        line += '\n';
+        std::cerr.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+    
+    // Preformatted message: handed to the async backend when it is running
+    static void dispatch(LogLevel level, const std::string& msg) {
+        if (AsyncLogger::running()) {
+            LogRecord record;
+            record.set_message(level, TscClock::now(), msg);
+            if (AsyncLogger::submit(record)) {
+                return;
+            }
+        }
+        write(level, msg);
+    }
+    
+    // "{}" format plus raw arguments; with the async backend running nothing
+    // is formatted on the calling thread
+    template <typename... Args>
+    static void dispatch(LogLevel level, const char* format, const Args&... args) {
+        LogRecord record;
+        if (AsyncLogger::running()) {
+            record.set_format(level, TscClock::now(), format, args...);
+            if (AsyncLogger::submit(record)) {
+                return;
+            }
+        }
+        record.set_format(level, 0, format, args...);
+        write(level, format_log_record(record));
+    }
 };
 
 // Static member will be defined in main.cpp to avoid multiple definitions
 // LogLevel Logger::current_level = LogLevel::INFO;
 
-#define LOG(level, msg) \
+// The message arguments are only evaluated once the level check passes.
+// Either LOG(level, std::string) or LOG(level, "format {}", args...).
+#define LOG(level, ...) \
     do { \
         if (static_cast<int>(level) >= static_cast<int>(Logger::current_level)) { \
-            std::cerr << "[" << Logger::get_timestamp() << "] " \
-                      << "[" << Logger::level_to_string(level) << "] " \
-                      << msg << std::endl; \
+            Logger::dispatch(level, __VA_ARGS__); \
         } \
     } while(0)
 
-#define LOG_DEBUG(msg) LOG(LogLevel::LOG_DEBUG, msg)
-#define LOG_INFO(msg)  LOG(LogLevel::LOG_INFO, msg)
-#define LOG_ERROR(msg) LOG(LogLevel::LOG_ERROR, msg)
+#define LOB_LOG_STRIPPED(level, ...) \
+    do { (void)sizeof((Logger::dispatch(level, __VA_ARGS__), 0)); } while(0)
+
+#if LOB_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) LOG(LogLevel::LOG_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOB_LOG_STRIPPED(LogLevel::LOG_DEBUG, __VA_ARGS__)
+#endif
+
+#if LOB_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(...)  LOG(LogLevel::LOG_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)  LOB_LOG_STRIPPED(LogLevel::LOG_INFO, __VA_ARGS__)
+#endif
+
+#if LOB_MIN_LOG_LEVEL <= 2
+#define LOG_ERROR(...) LOG(LogLevel::LOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOB_LOG_STRIPPED(LogLevel::LOG_ERROR, __VA_ARGS__)
+#endif
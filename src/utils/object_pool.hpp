@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Free-list backed slab of fixed-size slots. Memory is carved out in chunks and
+// recycled through an intrusive free list, so steady-state create/destroy never
+// touches the heap once the pool has grown to its working size.
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t capacity = 0) {
+        reserve(capacity);
+    }
+    
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    
+    // Uninitialised storage for one T
+    void* allocate() {
+        if (!free_list) {
+            grow(std::max<size_t>(total_capacity, MIN_CHUNK));
+        }
+        Slot* slot = free_list;
+        free_list = slot->next;
+        if (++used > peak) {
+            peak = used;
+        }
+        return slot->storage;
+    }
+    
+    void deallocate(void* ptr) {
+        Slot* slot = reinterpret_cast<Slot*>(ptr);
+        slot->next = free_list;
+        free_list = slot;
+        used--;
+    }
+    
+    template <typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate()) T(std::forward<Args>(args)...);
+    }
+    
+    void destroy(T* object) {
+        object->~T();
+        deallocate(object);
+    }
+    
+    // Takes every slot back at once without visiting live objects, which is
+    // only sound when they need no destructor. The free list is rebuilt in
+    // address order, chunk by chunk.
+    void release_all() {
+        static_assert(std::is_trivially_destructible<T>::value, "release_all skips destructors");
+        free_list = nullptr;
+        for (size_t c = chunks.size(); c > 0; --c) {
+            Slot* chunk = chunks[c - 1].get();
+            for (size_t i = chunk_sizes[c - 1]; i > 0; --i) {
+                chunk[i - 1].next = free_list;
+                free_list = &chunk[i - 1];
+            }
+        }
+        used = 0;
+    }
+    
+    // Make sure at least `capacity` slots exist in total
+    void reserve(size_t capacity) {
+        if (capacity > total_capacity) {
+            grow(capacity - total_capacity);
+        }
+    }
+    
+    size_t capacity() const { return total_capacity; }
+    size_t in_use() const { return used; }
+    size_t high_water_mark() const { return peak; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    
+    static constexpr size_t MIN_CHUNK = 64;
+    
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    std::vector<size_t> chunk_sizes;
+    Slot* free_list = nullptr;
+    size_t total_capacity = 0;
+    size_t used = 0;
+    size_t peak = 0;
+    
+    void grow(size_t count) {
+        std::unique_ptr<Slot[]> chunk(new Slot[count]);
+        // Thread the new slots onto the free list in address order
+        for (size_t i = count; i > 0; --i) {
+            chunk[i - 1].next = free_list;
+            free_list = &chunk[i - 1];
+        }
+        chunks.push_back(std::move(chunk));
+        chunk_sizes.push_back(count);
+        total_capacity += count;
+    }
+};
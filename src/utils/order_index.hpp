@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct OrderIndexStats {
+    size_t entries;
+    size_t slots;
+    size_t bytes;               // slot array only
+    double load_factor;
+    double mean_probe;          // slots inspected by a successful lookup, on average
+    size_t max_probe;           // ... and at worst
+};
+
+// Open-addressing map from order ID to a resting node. Slots live in one flat
+// array probed linearly in Robin Hood order (entries further from their home
+// slot go first), so both hits and misses stop after a short probe. Deletion
+// shifts the rest of the run back one slot instead of leaving tombstones, so
+// the table never degrades under add/cancel churn. Sequential order IDs land
+// in small runs of adjacent slots, which keeps the hot end of the table in
+// cache. The table doubles when it would pass half full; `reserve` pre-sizes it.
+template <typename T>
+class OrderIndex {
+public:
+    explicit OrderIndex(size_t capacity = 0) {
+        reserve(capacity);
+    }
+    
+    T* find(uint64_t key) const {
+        size_t i = locate(key);
+        return i == NOT_FOUND ? nullptr : slots[i].value;
+    }
+    
+    bool contains(uint64_t key) const { return locate(key) != NOT_FOUND; }
+    
+    // False (and no change) when `key` is already present
+    bool insert(uint64_t key, T* value) {
+        if ((count + 1) * 2 > slots.size()) {
+            rehash(slots.size() * 2);
+        }
+        
+        // Until the first swap the probe walks exactly where `key` would be
+        Slot incoming{key, value};
+        bool displaced = false;
+        for (size_t i = home(key), distance = 0;; i = (i + 1) & mask, ++distance) {
+            if (!slots[i].value) {
+                slots[i] = incoming;
+                count++;
+                return true;
+            }
+            if (!displaced && slots[i].key == key) {
+                return false;
+            }
+            size_t resident = distance_of(i);
+            if (resident < distance) {
+                std::swap(incoming, slots[i]);
+                distance = resident;
+                displaced = true;
+            }
+        }
+    }
+    
+    // Removes `key` and returns its value, nullptr when absent
+    T* erase(uint64_t key) {
+        size_t i = locate(key);
+        if (i == NOT_FOUND) {
+            return nullptr;
+        }
+        T* value = slots[i].value;
+        
+        // Backward shift until an empty slot or an entry already at home
+        size_t next = (i + 1) & mask;
+        while (slots[next].value && distance_of(next) > 0) {
+            slots[i] = slots[next];
+            i = next;
+            next = (next + 1) & mask;
+        }
+        slots[i] = Slot();
+        count--;
+        return value;
+    }
+    
+    // Empties the table in one sweep, keeping its size
+    void clear() {
+        std::fill(slots.begin(), slots.end(), Slot());
+        count = 0;
+    }
+    
+    // Room for at least `capacity` entries without growing
+    void reserve(size_t capacity) {
+        size_t wanted = MIN_SLOTS;
+        while (wanted < capacity * 2) {
+            wanted *= 2;
+        }
+        if (wanted > slots.size()) {
+            rehash(wanted);
+        }
+    }
+    
+    template <typename Visitor>
+    void for_each(Visitor&& visit) const {
+        for (const Slot& slot : slots) {
+            if (slot.value) {
+                visit(slot.key, slot.value);
+            }
+        }
+    }
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return slots.size() / 2; }
+    size_t memory_bytes() const { return slots.size() * sizeof(Slot); }
+    
+    // Walks the whole table; meant for reporting, not the hot path
+    OrderIndexStats stats() const {
+        OrderIndexStats stats{count, slots.size(), memory_bytes(),
+                              static_cast<double>(count) / slots.size(), 0.0, 0};
+        size_t total_probe = 0;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].value) {
+                size_t probe = distance_of(i) + 1;
+                total_probe += probe;
+                stats.max_probe = std::max(stats.max_probe, probe);
+            }
+        }
+        stats.mean_probe = count ? static_cast<double>(total_probe) / count : 0.0;
+        return stats;
+    }
+
+private:
+    // An empty slot has a null value; every key, 0 included, is usable
+    struct Slot {
+        uint64_t key = 0;
+        T* value = nullptr;
+    };
+    
+    static constexpr size_t MIN_SLOTS = 16;
+    static constexpr size_t NOT_FOUND = ~size_t(0);
+    
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    unsigned shift = 64;    // 64 - log2(slot count)
+    size_t count = 0;
+    
+    // Fibonacci hashing of 16-ID blocks, with the low 4 bits kept as an offset
+    // into the block. Sequential IDs share a 256-byte run of slots, while every
+    // other ID pattern (strides, a sliding window wider than the table) is
+    // spread over the whole table instead of piling onto a run of live entries.
+    size_t home(uint64_t key) const {
+        uint64_t block = ((key >> 4) * 0x9E3779B97F4A7C15ULL) >> shift;
+        return static_cast<size_t>(block ^ (key & 15)) & mask;
+    }
+    
+    size_t distance_of(size_t i) const {
+        return (i - home(slots[i].key)) & mask;
+    }
+    
+    // A resident closer to home than the probe means `key` would have been placed before it
+    size_t locate(uint64_t key) const {
+        for (size_t i = home(key), distance = 0; slots[i].value; i = (i + 1) & mask, ++distance) {
+            if (slots[i].key == key) {
+                return i;
+            }
+            if (distance_of(i) < distance) {
+                break;
+            }
+        }
+        return NOT_FOUND;
+    }
+    
+    void rehash(size_t slot_count) {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(std::max(slot_count, MIN_SLOTS), Slot());
+        mask = slots.size() - 1;
+        shift = 64 - static_cast<unsigned>(__builtin_ctzll(slots.size()));
+        count = 0;
+        for (const Slot& slot : old) {
+            if (slot.value) {
+                insert(slot.key, slot.value);
+            }
+        }
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer ring. Capacity is rounded
+// up to a power of two; each side caches the other's index so the shared
+// cache lines are only touched when the cached view runs out.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : buffer(round_up(capacity)), mask(buffer.size() - 1) {}
+    
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    
+    // Producer side
+    bool try_push(const T& item) {
+        uint64_t write = tail.load(std::memory_order_relaxed);
+        if (write - cached_head >= buffer.size()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (write - cached_head >= buffer.size()) {
+                return false;
+            }
+        }
+        buffer[write & mask] = item;
+        tail.store(write + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side
+    bool try_pop(T& item) {
+        uint64_t read = head.load(std::memory_order_relaxed);
+        if (read == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (read == cached_tail) {
+                return false;
+            }
+        }
+        item = buffer[read & mask];
+        head.store(read + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Items ever pushed / popped; safe to read from either side
+    uint64_t pushed() const { return tail.load(std::memory_order_acquire); }
+    uint64_t popped() const { return head.load(std::memory_order_acquire); }
+    bool empty() const { return pushed() == popped(); }
+    size_t capacity() const { return buffer.size(); }
+
+private:
+    static size_t round_up(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+    
+    std::vector<T> buffer;
+    const size_t mask;
+    
+    // Consumer-owned line
+    alignas(64) std::atomic<uint64_t> head{0};
+    uint64_t cached_tail = 0;
+    
+    // Producer-owned line
+    alignas(64) std::atomic<uint64_t> tail{0};
+    uint64_t cached_head = 0;
+};
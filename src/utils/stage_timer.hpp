@@ -0,0 +1,117 @@
+#pragma once
+
+#include "latency_histogram.hpp"
+#include "tsc_clock.hpp"
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+// Per-stage TSC timers for the matching path. With LOB_STAGE_TIMING=0 (the
+// default) the macros below expand to nothing and MatchingEngine carries no
+// StageStats member, so disabled builds pay nothing at all.
+#ifndef LOB_STAGE_TIMING
+#define LOB_STAGE_TIMING 0
+#endif
+
+enum class Stage : uint8_t {
+    VALIDATE,   // order checks before matching
+    MATCH,      // walk of the contra side or FOK check; includes its NOTIFY time
+    INSERT,     // resting the remainder in the book, or an add during an auction
+    NOTIFY,     // fill callback and sink for one fill, also counted in MATCH
+    CANCEL,
+    MODIFY,
+    COUNT
+};
+
+inline const char* stage_to_string(Stage stage) {
+    switch (stage) {
+        case Stage::VALIDATE: return "validate";
+        case Stage::MATCH:    return "match";
+        case Stage::INSERT:   return "insert";
+        case Stage::NOTIFY:   return "notify";
+        case Stage::CANCEL:   return "cancel";
+        case Stage::MODIFY:   return "modify";
+        case Stage::COUNT:    break;
+    }
+    return "unknown";
+}
+
+// One fixed-size histogram of raw TSC ticks per stage; converted to
+// nanoseconds only when reported
+class StageStats {
+public:
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+    
+    void record(Stage stage, uint64_t ticks) {
+        histograms[static_cast<size_t>(stage)].record(ticks);
+    }
+    
+    // Back-to-back stages share clock reads: mark() starts the first, and each
+    // lap() closes one stage and starts the next
+    void mark() {
+        last_mark = TscClock::now();
+    }
+    
+    void lap(Stage stage) {
+        uint64_t now = TscClock::now();
+        record(stage, now - last_mark);
+        last_mark = now;
+    }
+    
+    const LatencyHistogram& histogram(Stage stage) const {
+        return histograms[static_cast<size_t>(stage)];
+    }
+    
+    void reset() {
+        for (LatencyHistogram& histogram : histograms) {
+            histogram.reset();
+        }
+    }
+    
+    void print(std::ostream& out) const {
+        out << std::setw(10) << "stage" << std::setw(12) << "count" << std::setw(10) << "p50 ns"
+            << std::setw(10) << "p99 ns" << std::setw(10) << "p99.9 ns" << std::setw(12) << "max ns" << std::endl;
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            const LatencyHistogram& h = histograms[i];
+            out << std::setw(10) << stage_to_string(static_cast<Stage>(i)) << std::setw(12) << h.count()
+                << std::setw(10) << to_ns(h.percentile(0.50)) << std::setw(10) << to_ns(h.percentile(0.99))
+                << std::setw(10) << to_ns(h.percentile(0.999)) << std::setw(12) << to_ns(h.max()) << std::endl;
+        }
+    }
+    
+    // {"validate": {"count": ..., "p50_ns": ...}, "match": {...}, ...}
+    void write_json(std::ostream& out) const {
+        out << "{";
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            const LatencyHistogram& h = histograms[i];
+            out << (i ? ", " : "") << "\"" << stage_to_string(static_cast<Stage>(i)) << "\": {"
+                << "\"count\": " << h.count()
+                << ", \"p50_ns\": " << to_ns(h.percentile(0.50))
+                << ", \"p99_ns\": " << to_ns(h.percentile(0.99))
+                << ", \"p999_ns\": " << to_ns(h.percentile(0.999))
+                << ", \"max_ns\": " << to_ns(h.max()) << "}";
+        }
+        out << "}";
+    }
+
+private:
+    static uint64_t to_ns(uint64_t ticks) {
+        return static_cast<uint64_t>(TscClock::to_ns(ticks));
+    }
+    
+    std::array<LatencyHistogram, STAGE_COUNT> histograms;
+    uint64_t last_mark = 0;
+};
+
+#if LOB_STAGE_TIMING
+#define LOB_STAGE_MARK(stats) (stats).mark()
+#define LOB_STAGE_LAP(stats, stage) (stats).lap(stage)
+#define LOB_STAGE_BEGIN(name) const uint64_t name = TscClock::now()
+#define LOB_STAGE_END(stats, stage, name) (stats).record(stage, TscClock::now() - (name))
+#else
+#define LOB_STAGE_MARK(stats) static_cast<void>(0)
+#define LOB_STAGE_LAP(stats, stage) static_cast<void>(0)
+#define LOB_STAGE_BEGIN(name) static_cast<void>(0)
+#define LOB_STAGE_END(stats, stage, name) static_cast<void>(0)
+#endif
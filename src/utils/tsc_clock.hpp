@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cycle-counter clock for hot-path timestamps. Reads the TSC where available
+// (steady_clock nanoseconds elsewhere) and converts ticks to nanoseconds with
+// a ratio calibrated once against steady_clock.
+class TscClock {
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    
+    static double ns_per_tick() {
+        static const double ratio = calibrate();
+        return ratio;
+    }
+    
+    static double to_ns(uint64_t ticks) {
+        return static_cast<double>(ticks) * ns_per_tick();
+    }
+
+private:
+    static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto start_time = std::chrono::steady_clock::now();
+        uint64_t start_ticks = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto end_time = std::chrono::steady_clock::now();
+        uint64_t end_ticks = now();
+        
+        double elapsed_ns = std::chrono::duration<double, std::nano>(end_time - start_time).count();
+        return end_ticks > start_ticks ? elapsed_ns / static_cast<double>(end_ticks - start_ticks) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+};
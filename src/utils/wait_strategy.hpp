@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+enum class WaitStrategy {
+    BUSY_SPIN,  // never leave the core: lowest latency, burns a CPU per stage
+    YIELD,      // spin briefly, then yield the time slice
+    BLOCK       // spin briefly, then park on a condition variable until notified
+};
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+inline const char* wait_strategy_to_string(WaitStrategy strategy) {
+    switch (strategy) {
+        case WaitStrategy::BUSY_SPIN: return "busy-spin";
+        case WaitStrategy::YIELD:     return "yield";
+        case WaitStrategy::BLOCK:     return "block";
+    }
+    return "unknown";
+}
+
+// Idle policy for a consumer stage waiting on its input ring. Producers call
+// notify() after every push; it only costs a fence unless the consumer is parked.
+class StageWaiter {
+public:
+    explicit StageWaiter(WaitStrategy strategy) : strategy(strategy) {}
+    
+    StageWaiter(const StageWaiter&) = delete;
+    StageWaiter& operator=(const StageWaiter&) = delete;
+    
+    // Called once per empty poll; `ready` re-checks for work before parking
+    template <typename Ready>
+    void wait(unsigned& spins, Ready&& ready) {
+        if (strategy == WaitStrategy::BUSY_SPIN || spins < SPIN_LIMIT) {
+            spins++;
+            cpu_relax();
+            return;
+        }
+        if (strategy == WaitStrategy::YIELD) {
+            std::this_thread::yield();
+            return;
+        }
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // The timeout bounds the cost of any wakeup that slips past the fence
+        condition.wait_for(lock, MAX_PARK, ready);
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+    
+    void notify() {
+        if (strategy != WaitStrategy::BLOCK) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_one();
+        }
+    }
+    
+    // Producer side of a full ring: same policy, but nothing to park on
+    void backoff(unsigned& spins) const {
+        if (strategy == WaitStrategy::BUSY_SPIN || spins < SPIN_LIMIT) {
+            spins++;
+            cpu_relax();
+        } else if (strategy == WaitStrategy::YIELD) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+private:
+    static constexpr unsigned SPIN_LIMIT = 64;
+    static constexpr std::chrono::microseconds MAX_PARK{200};
+    
+    const WaitStrategy strategy;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<bool> sleeping{false};
+};
@@ -3,15 +3,62 @@
 
 #include "order.hpp"
 #include "order_book.hpp"
+#include "map_order_book.hpp"
 #include "matching_engine.hpp"
+#include "exchange_simulator.hpp"
+#include "sharded_exchange.hpp"
+#include "pipeline.hpp"
+#include "book_builder.hpp"
+#include "journal.hpp"
+#include "snapshot.hpp"
+#include "monte_carlo.hpp"
 #include "utils/logger.hpp"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <unordered_map>
 
 // Define logger static member
 LogLevel Logger::current_level = LogLevel::LOG_ERROR;
 
+// Count global heap allocations while counting_allocations is set, so tests can
+// prove a path stays off the heap. Atomic because later tests allocate from
+// worker threads.
+static std::atomic<size_t> allocation_count{0};
+static std::atomic<bool> counting_allocations{false};
+
+void* operator new(size_t size) {
+    if (counting_allocations.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
 // Simple test framework
 void test_order_creation() {
     std::cout << "Testing order creation...";
@@ -19,10 +66,10 @@ void test_order_creation() {
     // Valid limit order
     Order order1 = Order::create_limit_order(1, 100.50, 200, "BUY");
     assert(order1.order_id == 1);
-    assert(order1.price == 100.50);
+    assert(order1.price == 10050);
     assert(order1.quantity == 200);
-    assert(order1.side == "BUY");
-    assert(order1.type == "LIMIT");
+    assert(order1.side == Side::BUY);
+    assert(order1.type == OrderType::LIMIT);
     assert(order1.is_buy());
     assert(order1.is_limit());
     assert(!order1.is_sell());
@@ -31,10 +78,10 @@ void test_order_creation() {
     // Valid market order
     Order order2 = Order::create_market_order(2, 100, "SELL");
     assert(order2.order_id == 2);
-    assert(order2.price == 0.0);
+    assert(order2.price == 0);
     assert(order2.quantity == 100);
-    assert(order2.side == "SELL");
-    assert(order2.type == "MARKET");
+    assert(order2.side == Side::SELL);
+    assert(order2.type == OrderType::MARKET);
     assert(order2.is_sell());
     assert(order2.is_market());
     
@@ -46,6 +93,44 @@ void test_order_creation() {
         // Expected
     }
     
+    // Prices whose tick count overflows a Price are rejected, not wrapped
+    try {
+        Order::create_limit_order(1, 50000000.0, 10, "BUY");
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+    Price ticks = 0;
+    assert(!try_price_to_ticks(50000000.0, DEFAULT_TICK_SIZE, ticks));
+    assert(!try_price_to_ticks(std::nan(""), DEFAULT_TICK_SIZE, ticks));
+    assert(try_price_to_ticks(21474836.47, DEFAULT_TICK_SIZE, ticks) && ticks == INT32_MAX);
+    assert(price_to_ticks(50000000.0, DEFAULT_TICK_SIZE) == INT32_MAX);
+    
+    // Limit prices are carried in ticks of the requested size
+    Order order3 = Order::create_limit_order(3, 100.50, 10, "SELL", 0.25);
+    assert(order3.price == 402);
+    
+    // Enum factories build the same compact record without strings
+    Order order4 = Order::limit_order(4, 10050, 200, Side::BUY);
+    assert(order4.is_buy() && order4.is_limit() && order4.price == order1.price);
+    assert(Order::market_order(5, 100, Side::SELL).is_market());
+    
+    // Equal timestamps sort by id, while the book keeps arrival order
+    Order first = Order::limit_order(9, 10050, 10, Side::BUY);
+    Order second = Order::limit_order(8, 10050, 10, Side::BUY);
+    first.timestamp = second.timestamp = 1000;
+    assert(second < first && !(first < second));
+    MatchingEngine fifo;
+    fifo.process_order(first);
+    fifo.process_order(second);
+    std::vector<Fill> fifo_fills = fifo.process_order(Order::limit_order(10, 10050, 10, Side::SELL));
+    assert(fifo_fills.size() == 1 && fifo_fills[0].buy_order_id == 9);
+    
+    // The engine rejects unvalidated records that would be invalid
+    MatchingEngine engine;
+    assert(engine.process_order(Order::limit_order(6, 0, 10, Side::BUY)).empty());
+    assert(engine.process_order(Order::limit_order(7, 10050, 0, Side::BUY)).empty());
+    assert(engine.get_order_book().empty());
+    
     std::cout << " PASSED\n";
 }
 
@@ -134,20 +219,1504 @@ void test_matching_basic() {
     std::cout << " PASSED\n";
 }
 
+void test_price_ladder() {
+    std::cout << "Testing tick price ladder...";
+    
+    // Prices that differ only by floating-point noise share a level
+    OrderBook book(0.01, 16);
+    book.add_order(Order::create_limit_order(1, 100.1, 100, "BUY"));
+    book.add_order(Order::create_limit_order(2, 100.10000000001, 50, "BUY"));
+    auto bids = book.get_bid_levels();
+    assert(bids.size() == 1);
+    assert(bids[0].price == 100.10);
+    assert(bids[0].total_quantity == 150);
+    assert(bids[0].order_count == 2);
+    
+    // Prices far outside the initial ladder grow it in both directions
+    book.add_order(Order::create_limit_order(3, 99.00, 10, "BUY"));
+    book.add_order(Order::create_limit_order(4, 250.00, 20, "SELL"));
+    book.add_order(Order::create_limit_order(5, 120.00, 30, "SELL"));
+    TopOfBook tob = book.get_top_of_book();
+    assert(tob.best_bid.value() == 100.10);
+    assert(tob.best_ask.value() == 120.00);
+    
+    // Emptying the best level moves the touch to the next populated level
+    assert(book.cancel_order(5));
+    assert(book.get_top_of_book().best_ask.value() == 250.00);
+    assert(book.cancel_order(1));
+    assert(book.cancel_order(2));
+    bids = book.get_bid_levels();
+    assert(bids.size() == 1 && bids[0].price == 99.00);
+    assert(book.total_orders() == 2);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_matching_sweep() {
+    std::cout << "Testing multi-level sweep...";
+    
+    MatchingEngine engine;
+    for (int i = 0; i < 5; ++i) {
+        engine.process_order(Order::create_limit_order(i + 1, 101.00 + i, 100, "SELL"));
+    }
+    
+    // Buy through three levels; the remainder rests at the limit price
+    auto fills = engine.process_order(Order::create_limit_order(10, 103.00, 350, "BUY"));
+    assert(fills.size() == 3);
+    assert(fills[0].price == 101.00 && fills[0].sell_order_id == 1);
+    assert(fills[2].price == 103.00 && fills[2].sell_order_id == 3);
+    
+    TopOfBook tob = engine.get_order_book().get_top_of_book();
+    assert(tob.best_bid.value() == 103.00 && tob.bid_quantity.value() == 50);
+    assert(tob.best_ask.value() == 104.00);
+    
+    // Market sell takes the resting bid and then stops at an empty side
+    fills = engine.process_order(Order::create_market_order(11, 80, "SELL"));
+    assert(fills.size() == 1 && fills[0].quantity == 50);
+    assert(!engine.get_order_book().get_top_of_book().best_bid.has_value());
+    
+    // Filled orders can no longer be cancelled
+    assert(!engine.cancel_order(1));
+    assert(engine.cancel_order(4));
+    
+    std::cout << " PASSED\n";
+}
+
+void test_cancel_preserves_fifo() {
+    std::cout << "Testing cancel keeps FIFO order...";
+    
+    MatchingEngine engine;
+    for (int i = 1; i <= 5; ++i) {
+        engine.process_order(Order::create_limit_order(i, 100.00, 10 * i, "BUY"));
+    }
+    
+    // Unlink from the middle, the head and the tail of the queue
+    assert(engine.cancel_order(3));
+    assert(engine.cancel_order(1));
+    assert(engine.cancel_order(5));
+    assert(!engine.cancel_order(3));
+    assert(engine.modify_order(4, 7));
+    assert(engine.get_order_book().total_orders() == 2);
+    
+    auto bids = engine.get_order_book().get_bid_levels();
+    assert(bids.size() == 1 && bids[0].order_count == 2 && bids[0].total_quantity == 27);
+    
+    // Remaining orders still fill in arrival order
+    auto fills = engine.process_order(Order::create_market_order(6, 27, "SELL"));
+    assert(fills.size() == 2);
+    assert(fills[0].buy_order_id == 2 && fills[0].quantity == 20);
+    assert(fills[1].buy_order_id == 4 && fills[1].quantity == 7);
+    assert(engine.get_order_book().empty());
+    
+    // Duplicate ids are rejected rather than orphaning the resting order
+    OrderBook book;
+    assert(book.add_order(Order::create_limit_order(1, 100.00, 10, "BUY")));
+    assert(!book.add_order(Order::create_limit_order(1, 101.00, 10, "SELL")));
+    assert(book.total_orders() == 1);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_pooled_book_allocations() {
+    std::cout << "Testing pooled book allocations...";
+    
+    OrderBook book(0.01, 1024, 256);
+    Order buy = Order::limit_order(0, 9900, 100, Side::BUY);
+    Order sell = Order::limit_order(0, 10100, 100, Side::SELL);
+    
+    // Warm up: touch every price the loop will use and cycle the pools once
+    auto cycle = [&](uint64_t base_id) {
+        for (int i = 0; i < 100; ++i) {
+            buy.order_id = base_id + i;
+            buy.price = 9900 - i % 10;
+            book.add_order(buy);
+            sell.order_id = base_id + 100 + i;
+            sell.price = 10100 + i % 10;
+            book.add_order(sell);
+        }
+        // Match away half of each side from the touch, cancel the rest
+        for (int i = 0; i < 50; ++i) {
+            book.consume_front(true, book.front_order(true).quantity);
+            book.consume_front(false, 40);
+            book.consume_front(false, 60);
+        }
+        for (int i = 0; i < 100; ++i) {
+            book.cancel_order(base_id + i);
+            book.cancel_order(base_id + 100 + i);
+        }
+    };
+    cycle(1);
+    assert(book.empty());
+    
+    size_t before = allocation_count.load();
+    counting_allocations = true;
+    for (uint64_t round = 1; round <= 20; ++round) {
+        cycle(round * 1000);
+    }
+    counting_allocations = false;
+    assert(allocation_count.load() == before);
+    assert(book.empty());
+    
+    BookMemoryStats stats = book.memory_stats();
+    assert(stats.order_capacity == 256);
+    assert(stats.orders_in_use == 0);
+    assert(stats.order_high_water_mark == 200);
+    assert(stats.level_high_water_mark == 20);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_fill_sinks() {
+    std::cout << "Testing fill sinks...";
+    
+    MatchingEngine engine;
+    std::vector<Fill> fills;
+    fills.reserve(16);
+    
+    // Warm up the book pools at the prices the loop uses
+    auto round_trip = [&](uint64_t id) {
+        engine.process_order(Order::limit_order(id, 10000, 100, Side::SELL), fills);
+        engine.process_order(Order::limit_order(id + 1, 10001, 100, Side::SELL), fills);
+        engine.process_order(Order::limit_order(id + 2, 10001, 150, Side::BUY), fills);
+        engine.process_order(Order::market_order(id + 3, 50, Side::BUY), fills);
+    };
+    round_trip(1);
+    assert(fills.size() == 3);
+    assert(fills[0].sell_order_id == 1 && fills[1].sell_order_id == 2 && fills[2].quantity == 50);
+    
+    // Reusing the buffer keeps matching off the heap
+    size_t before = allocation_count.load();
+    counting_allocations = true;
+    for (uint64_t id = 10; id < 1000; id += 4) {
+        fills.clear();
+        round_trip(id);
+        assert(fills.size() == 3);
+    }
+    counting_allocations = false;
+    assert(allocation_count.load() == before);
+    
+    // A compile-time sink sees fills inline, and statistics stay in step
+    size_t sunk = 0;
+    int sunk_quantity = 0;
+    engine.process_order(Order::limit_order(5000, 10000, 70, Side::SELL), [](const Fill&) {});
+    size_t count = engine.process_order(Order::market_order(5001, 70, Side::BUY),
+        [&](const Fill& fill) { sunk++; sunk_quantity += fill.quantity; });
+    assert(count == 1 && sunk == 1 && sunk_quantity == 70);
+    assert(engine.total_fills() == 3 * 249 + 1);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_map_book_parity() {
+    std::cout << "Testing map book parity...";
+    
+    OrderBook ladder_book;
+    MapOrderBook map_book;
+    double prices[] = {100.00, 100.25, 99.75, 100.25, 101.50, 98.00};
+    for (int i = 0; i < 6; ++i) {
+        Order order = Order::create_limit_order(i + 1, prices[i], 10 * (i + 1), i % 2 ? "SELL" : "BUY");
+        ladder_book.add_order(order);
+        map_book.add_order(order);
+    }
+    ladder_book.cancel_order(3);
+    map_book.cancel_order(3);
+    
+    auto ladder_bids = ladder_book.get_bid_levels(10);
+    auto map_bids = map_book.get_bid_levels(10);
+    auto ladder_asks = ladder_book.get_ask_levels(10);
+    auto map_asks = map_book.get_ask_levels(10);
+    assert(ladder_bids.size() == map_bids.size());
+    assert(ladder_asks.size() == map_asks.size());
+    for (size_t i = 0; i < ladder_bids.size(); ++i) {
+        assert(ladder_bids[i].price == map_bids[i].price);
+        assert(ladder_bids[i].total_quantity == map_bids[i].total_quantity);
+    }
+    for (size_t i = 0; i < ladder_asks.size(); ++i) {
+        assert(ladder_asks[i].price == map_asks[i].price);
+        assert(ladder_asks[i].total_quantity == map_asks[i].total_quantity);
+    }
+    assert(ladder_book.total_orders() == map_book.total_orders());
+    
+    std::cout << " PASSED\n";
+}
+
+void test_level_aggregates() {
+    std::cout << "Testing level aggregates...";
+    
+    // Drive both books with the same random flow; MapOrderBook re-sums its
+    // levels on every query, so it serves as the reference for the running totals
+    OrderBook book;
+    MapOrderBook reference;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> op_dist(0, 9);
+    std::uniform_int_distribution<> price_dist(-20, 20);
+    std::uniform_int_distribution<> qty_dist(1, 500);
+    uint64_t next_id = 1;
+    
+    for (int step = 0; step < 5000; ++step) {
+        int op = op_dist(gen);
+        if (op < 5 || book.empty()) {
+            Side side = gen() % 2 ? Side::BUY : Side::SELL;
+            Price price = (side == Side::BUY ? 9990 : 10010) + price_dist(gen);
+            Order order = Order::limit_order(next_id++, price, qty_dist(gen), side);
+            book.add_order(order);
+            reference.add_order(order);
+        } else if (op < 7) {
+            uint64_t id = 1 + gen() % next_id;
+            assert(book.cancel_order(id) == reference.cancel_order(id));
+        } else if (op < 9) {
+            uint64_t id = 1 + gen() % next_id;
+            int quantity = qty_dist(gen);
+            assert(book.reduce_order(id, quantity) == reference.reduce_order(id, quantity));
+        } else {
+            bool buy_side = book.has_orders(true);
+            int quantity = std::min(book.front_order(buy_side).quantity, qty_dist(gen));
+            book.consume_front(buy_side, quantity);
+            reference.consume_front(buy_side, quantity);
+        }
+    }
+    
+    auto bids = book.get_bid_levels(1000);
+    auto asks = book.get_ask_levels(1000);
+    auto ref_bids = reference.get_bid_levels(1000);
+    auto ref_asks = reference.get_ask_levels(1000);
+    assert(bids.size() == ref_bids.size() && asks.size() == ref_asks.size());
+    
+    int64_t quantity = 0;
+    for (size_t i = 0; i < bids.size(); ++i) {
+        assert(bids[i].price == ref_bids[i].price);
+        assert(bids[i].total_quantity == ref_bids[i].total_quantity);
+        assert(bids[i].order_count == ref_bids[i].order_count);
+        quantity += bids[i].total_quantity;
+    }
+    assert(book.side_quantity(true) == quantity);
+    for (size_t i = 0; i < asks.size(); ++i) {
+        assert(asks[i].price == ref_asks[i].price);
+        assert(asks[i].total_quantity == ref_asks[i].total_quantity);
+        assert(asks[i].order_count == ref_asks[i].order_count);
+        quantity += asks[i].total_quantity;
+    }
+    assert(book.total_quantity() == quantity);
+    assert(book.total_orders() == reference.total_orders());
+    
+    TopOfBook tob = book.get_top_of_book();
+    TopOfBook ref_tob = reference.get_top_of_book();
+    assert(tob.bid_quantity == ref_tob.bid_quantity && tob.ask_quantity == ref_tob.ask_quantity);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_async_logger() {
+    std::cout << "Testing async logger...";
+    
+    auto read_all = [](std::FILE* file) {
+        std::string contents;
+        char buffer[4096];
+        std::rewind(file);
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            contents.append(buffer, n);
+        }
+        return contents;
+    };
+    
+    // Arguments are captured raw and expanded when the record is drained
+    LogRecord record;
+    record.set_format(LogLevel::LOG_ERROR, 0, "id {} qty {} px {} side {}", uint64_t(42), -7, 100.5, "BUY");
+    assert(format_log_record(record) == "id 42 qty -7 px 100.5 side BUY");
+    record.set_message(LogLevel::LOG_ERROR, 0, "plain {}");
+    assert(format_log_record(record) == "plain {}");
+    
+    // Everything submitted before stop() reaches the sink
+    std::FILE* sink = std::tmpfile();
+    AsyncLoggerConfig config;
+    config.sink = sink;
+    AsyncLogger::start(config);
+    assert(AsyncLogger::running());
+    for (int i = 0; i < 100; ++i) {
+        LOG_ERROR("async line {}", i);
+    }
+    AsyncLogger::stop();
+    assert(!AsyncLogger::running());
+    std::string written = read_all(sink);
+    assert(written.find("[ERROR] async line 0\n") != std::string::npos);
+    assert(written.find("[ERROR] async line 99\n") != std::string::npos);
+    std::fclose(sink);
+    
+    // A full ring under the DROP policy counts what it discards
+    sink = std::tmpfile();
+    config.sink = sink;
+    config.ring_capacity = 4;
+    config.idle_sleep = std::chrono::microseconds(200000);
+    AsyncLogger::start(config);
+    for (int i = 0; i < 64; ++i) {
+        LOG_ERROR("burst {}", i);
+    }
+    AsyncLogger::flush();
+    uint64_t dropped = AsyncLogger::dropped();
+    AsyncLogger::stop();
+    written = read_all(sink);
+    size_t lines = static_cast<size_t>(std::count(written.begin(), written.end(), '\n'));
+    assert(dropped > 0);
+    assert(lines + dropped == 64);
+    std::fclose(sink);
+    
+    // Stopping under producers blocked on full rings: each record is either
+    // drained to the sink or falls back to a synchronous write on stderr
+    sink = std::tmpfile();
+    std::FILE* fallback = std::tmpfile();
+    std::fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    dup2(fileno(fallback), STDERR_FILENO);
+    config.sink = sink;
+    config.overflow = OverflowPolicy::BLOCK;
+    config.idle_sleep = std::chrono::microseconds(50);
+    AsyncLogger::start(config);
+    std::atomic<int> started{0};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&started]() {
+            started.fetch_add(1);
+            for (int i = 0; i < 5000; ++i) {
+                LOG_ERROR("racing {}", i);
+            }
+        });
+    }
+    while (started.load() < 4) {
+        std::this_thread::yield();
+    }
+    AsyncLogger::stop();
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    std::fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+    written = read_all(sink) + read_all(fallback);
+    assert(std::count(written.begin(), written.end(), '\n') == 4 * 5000);
+    std::fclose(sink);
+    std::fclose(fallback);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_headless_replay() {
+    std::cout << "Testing headless replay...";
+    
+    // Log-linear buckets keep quantiles within a few percent
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        histogram.record(v);
+    }
+    assert(histogram.count() == 1000 && histogram.min() == 1 && histogram.max() == 1000);
+    assert(histogram.percentile(0.5) >= 500 && histogram.percentile(0.5) <= 532);
+    assert(histogram.percentile(1.0) == 1000);
+    
+    // The same seed replays the same flow to the same final book
+    ExchangeSimulator simulator;
+    HeadlessReport first = simulator.run_headless(20000, 7);
+    HeadlessReport second = simulator.run_headless(20000, 7);
+    assert(first.latency.count() == 20000);
+    assert(first.fill_count > 0 && first.fill_count == second.fill_count);
+    assert(first.resting_bids == second.resting_bids && first.resting_asks == second.resting_asks);
+    assert(simulator.get_engine().get_order_book().empty());
+    assert(Logger::current_level == LogLevel::LOG_ERROR);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_flow_record_replay() {
+    std::cout << "Testing flow record/replay...";
+    
+    // Commands drive the engine the same way as the direct calls
+    MatchingEngine engine;
+    std::vector<Fill> fills;
+    engine.execute(Command::add(1, Order::limit_order(1, 10000, 100, Side::SELL)), fills);
+    engine.execute(Command::modify(2, 1, 60), fills);
+    engine.execute(Command::add(3, Order::limit_order(2, 10001, 40, Side::SELL)), fills);
+    engine.execute(Command::cancel(4, 2), fills);
+    assert(engine.execute(Command::add(5, Order::market_order(3, 80, Side::BUY)), fills) == 1);
+    assert(fills.size() == 1 && fills[0].quantity == 60);
+    assert(engine.get_order_book().empty());
+    
+    char path[] = "/tmp/lob_flow_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    
+    // Record a generated run, then replay the file through a fresh engine
+    ExchangeSimulator simulator;
+    FlowRecorder recorder;
+    assert(recorder.open(path, 0.01));
+    simulator.set_recorder(&recorder);
+    HeadlessReport recorded = simulator.run_headless(5000, 11);
+    simulator.set_recorder(nullptr);
+    assert(recorder.close() && recorder.recorded() == 5000);
+    
+    FlowReader reader;
+    assert(reader.open(path));
+    assert(reader.size() == 5000 && reader.tick_size() == 0.01);
+    assert(reader.begin()[0].sequence == 1 && reader.begin()[4999].order.order_id == 5000);
+    reader.close();
+    
+    HeadlessReport replayed;
+    assert(simulator.run_replay(path, replayed));
+    assert(replayed.command_count == 5000);
+    assert(replayed.fill_count == recorded.fill_count);
+    assert(replayed.resting_bids == recorded.resting_bids && replayed.resting_asks == recorded.resting_asks);
+    
+    // Anything without the flow header is rejected
+    std::FILE* junk = std::fopen(path, "wb");
+    std::fputs("definitely not a flow file, just some text", junk);
+    std::fclose(junk);
+    assert(!reader.open(path));
+    std::remove(path);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_sharded_exchange() {
+    std::cout << "Testing sharded exchange...";
+    
+    // Symbols stay on their shard and each book matches a standalone engine
+    ShardedExchangeConfig config;
+    config.shard_count = 3;
+    config.symbol_count = 8;
+    config.pin_threads = false;
+    ShardedExchange exchange(config);
+    exchange.start();
+    assert(exchange.shard_count() == 3 && exchange.shard_of(7) == 1);
+    
+    std::vector<std::unique_ptr<MatchingEngine>> reference;
+    for (size_t i = 0; i < config.symbol_count; ++i) {
+        reference.push_back(std::make_unique<MatchingEngine>());
+    }
+    
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<> price_dist(9990, 10010);
+    std::uniform_int_distribution<> quantity_dist(1, 100);
+    size_t expected_fills = 0;
+    for (uint64_t id = 1; id <= 20000; ++id) {
+        uint16_t symbol = static_cast<uint16_t>(gen() % config.symbol_count);
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        Command command = Command::add(id, Order::limit_order(id, price_dist(gen), quantity_dist(gen), side, symbol));
+        if (id % 7 == 0) {
+            command = Command::cancel(id, id - 3, 0, symbol);
+        } else if (id % 11 == 0) {
+            command = Command::replace(id, id - 5, 1 + gen() % 50, price_dist(gen), 0, symbol);
+        }
+        assert(exchange.submit(command));
+        expected_fills += reference[symbol]->execute(command, [](const Fill&) {});
+    }
+    assert(!exchange.submit(Command::add(20001, Order::limit_order(20001, 10000, 1, Side::BUY, 8))));
+    
+    exchange.wait_idle();
+    assert(exchange.total_fills() == expected_fills);
+    uint64_t commands = 0;
+    for (size_t shard = 0; shard < exchange.shard_count(); ++shard) {
+        commands += exchange.shard_stats(shard).commands;
+    }
+    assert(commands == 20000);
+    for (uint16_t symbol = 0; symbol < config.symbol_count; ++symbol) {
+        const OrderBook& book = exchange.engine_for(symbol).get_order_book();
+        const OrderBook& ref = reference[symbol]->get_order_book();
+        assert(book.total_orders() == ref.total_orders());
+        assert(book.total_quantity() == ref.total_quantity());
+    }
+    try {
+        exchange.engine_for(8);
+        assert(false);
+    } catch (const std::out_of_range&) {
+    }
+    
+    // A mass cancel reaches only its own symbol's book, unless it is for
+    // ALL_SYMBOLS, which every shard applies to each of its books
+    assert(exchange.engine_for(3).get_order_book().side_orders(true) > 0);
+    assert(exchange.submit(Command::mass_cancel(20001, MassCancel::of_side(Side::BUY), 0, 3)));
+    exchange.wait_idle();
+    assert(exchange.engine_for(3).get_order_book().side_orders(true) == 0);
+    assert(exchange.engine_for(4).get_order_book().side_orders(true) > 0);
+    assert(exchange.submit(Command::mass_cancel(20002, MassCancel::all(), 0, ALL_SYMBOLS)));
+    exchange.wait_idle();
+    for (uint16_t symbol = 0; symbol < config.symbol_count; ++symbol) {
+        assert(exchange.engine_for(symbol).get_order_book().empty());
+    }
+    assert(exchange.shard_stats(0).commands + exchange.shard_stats(1).commands +
+           exchange.shard_stats(2).commands == 20000 + 1 + 3);
+    exchange.stop();
+    
+    std::cout << " PASSED\n";
+}
+
+void test_order_pipeline() {
+    std::cout << "Testing order pipeline...";
+    
+    Command command;
+    assert(parse_command("ADD BUY LIMIT 100.50 200", 24, DEFAULT_TICK_SIZE, command));
+    assert(command.type == CommandType::ADD && command.order.price == 10050 && command.order.quantity == 200);
+    assert(parse_command("add sell market 0 10", 20, DEFAULT_TICK_SIZE, command));
+    assert(command.order.is_market() && command.order.side == Side::SELL);
+    assert(parse_command("MODIFY 12 300", 13, DEFAULT_TICK_SIZE, command));
+    assert(command.type == CommandType::MODIFY && command.order.order_id == 12);
+    assert(command.order.price == 0);
+    assert(parse_command("MODIFY 12 300 100.25", 20, DEFAULT_TICK_SIZE, command));
+    assert(command.order.quantity == 300 && command.order.price == 10025);
+    assert(!parse_command("MODIFY 12 300 0", 15, DEFAULT_TICK_SIZE, command));
+    assert(!parse_command("ADD BUY LIMIT -1 10", 19, DEFAULT_TICK_SIZE, command));
+    assert(!parse_command("ADD BUY LIMIT 100 0", 19, DEFAULT_TICK_SIZE, command));
+    assert(!parse_command("ADD BUY LIMIT 50000000 10", 25, DEFAULT_TICK_SIZE, command));
+    assert(!parse_command("MODIFY 12 300 50000000", 22, DEFAULT_TICK_SIZE, command));
+    assert(!parse_command("CANCEL 12x", 10, DEFAULT_TICK_SIZE, command));
+    assert(!parse_command("HOLD 1", 6, DEFAULT_TICK_SIZE, command));
+    
+    // Staged execution must leave the same book as running the commands inline
+    for (WaitStrategy strategy : {WaitStrategy::YIELD, WaitStrategy::BLOCK}) {
+        PipelineConfig config;
+        config.ring_capacity = 256;
+        config.wait_strategy = strategy;
+        uint64_t handled = 0;
+        OrderPipeline pipeline(config, [&handled](const Fill&) { handled++; });
+        MatchingEngine reference;
+        pipeline.start();
+        
+        std::mt19937 gen(9);
+        uint64_t sequence = 0;
+        uint64_t adds = 0;
+        size_t expected_fills = 0;
+        char line[64];
+        for (int i = 0; i < 5000; ++i) {
+            if (i % 10 == 9) {
+                std::snprintf(line, sizeof(line), "CANCEL %llu", static_cast<unsigned long long>(adds - 2));
+            } else {
+                std::snprintf(line, sizeof(line), "ADD %s LIMIT %.2f %d", gen() % 2 ? "BUY" : "SELL",
+                              (9990 + gen() % 21) / 100.0, static_cast<int>(1 + gen() % 100));
+            }
+            assert(pipeline.submit(line));
+            
+            assert(parse_command(line, std::strlen(line), DEFAULT_TICK_SIZE, command));
+            command.sequence = ++sequence;
+            if (command.type == CommandType::ADD) {
+                command.order.order_id = ++adds;
+            }
+            expected_fills += reference.execute(command, [](const Fill&) {});
+        }
+        assert(pipeline.submit("ADD BUY STOP 100 10"));
+        
+        pipeline.wait_idle();
+        assert(pipeline.rejected() == 1 && pipeline.completed() == 5000);
+        assert(pipeline.fills() == expected_fills && handled == expected_fills);
+        assert(pipeline.latency().count() == 5000);
+        const OrderBook& book = pipeline.engine().get_order_book();
+        assert(book.total_orders() == reference.get_order_book().total_orders());
+        assert(book.total_quantity() == reference.get_order_book().total_quantity());
+        pipeline.stop();
+    }
+    
+    std::cout << " PASSED\n";
+}
+
+void test_level_update_feed() {
+    std::cout << "Testing level update feed...";
+    
+    MatchingEngine engine;
+    OrderBook& book = engine.get_order_book();
+    std::vector<LevelUpdate> updates;
+    BookBuilder builder;
+    book.set_level_listener([&](const LevelUpdate& update) {
+        updates.push_back(update);
+        assert(builder.apply(update));
+    });
+    
+    // One update per touched level, carrying its new totals
+    engine.process_order(Order::limit_order(1, 10000, 100, Side::SELL));
+    engine.process_order(Order::limit_order(2, 10000, 50, Side::SELL));
+    assert(updates.size() == 2 && updates[1].sequence == 2);
+    assert(updates[1].price == 10000 && updates[1].total_quantity == 150 && updates[1].order_count == 2);
+    
+    engine.process_order(Order::limit_order(3, 10000, 120, Side::BUY));
+    assert(updates.size() == 4);
+    assert(updates[2].total_quantity == 50 && updates[2].order_count == 1);
+    assert(updates[3].total_quantity == 30 && updates[3].order_count == 1);
+    
+    engine.modify_order(2, 40);
+    engine.cancel_order(2);
+    assert(updates.back().side == Side::SELL && updates.back().total_quantity == 0);
+    assert(builder.level_count(false) == 0);
+    
+    // Random flow: the rebuilt depth must always match the book
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> price_dist(9980, 10020);
+    std::uniform_int_distribution<> quantity_dist(1, 200);
+    for (uint64_t id = 10; id < 5000; ++id) {
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        if (id % 5 == 0) {
+            engine.cancel_order(id - 4);
+        } else if (id % 7 == 0) {
+            engine.modify_order(id - 6, quantity_dist(gen));
+        } else {
+            engine.process_order(Order::limit_order(id, price_dist(gen), quantity_dist(gen), side));
+        }
+    }
+    assert(builder.last_sequence() == book.update_sequence() && builder.gap_count() == 0);
+    for (bool buy_side : {true, false}) {
+        auto expected = buy_side ? book.get_bid_levels(100) : book.get_ask_levels(100);
+        auto rebuilt = buy_side ? builder.get_bid_levels(100) : builder.get_ask_levels(100);
+        assert(expected.size() == rebuilt.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            assert(expected[i].price == rebuilt[i].price);
+            assert(expected[i].total_quantity == rebuilt[i].total_quantity);
+            assert(expected[i].order_count == rebuilt[i].order_count);
+        }
+    }
+    
+    // A skipped update is reported but still applied
+    BookBuilder late;
+    assert(!late.apply({5, 10000, 10, 1, Side::BUY}));
+    assert(late.gap_count() == 1 && late.get_top_of_book().bid_quantity == 10);
+    
+    std::cout << " PASSED\n";
+}
+
+// Same resting orders in the same FIFO positions, same counters
+bool same_engine_state(const MatchingEngine& a, const MatchingEngine& b) {
+    std::vector<Order> left;
+    std::vector<Order> right;
+    for (bool buy_side : {true, false}) {
+        a.get_order_book().for_each_order(buy_side, [&left](const Order& order) { left.push_back(order); });
+        b.get_order_book().for_each_order(buy_side, [&right](const Order& order) { right.push_back(order); });
+    }
+    if (left.size() != right.size() || a.total_fills() != b.total_fills()) {
+        return false;
+    }
+    for (size_t i = 0; i < left.size(); ++i) {
+        if (left[i].order_id != right[i].order_id || left[i].price != right[i].price ||
+            left[i].quantity != right[i].quantity || left[i].timestamp != right[i].timestamp) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_journal_recovery() {
+    std::cout << "Testing journal and snapshot recovery...";
+    
+    char snapshot_path[] = "/tmp/lob_snapshot_XXXXXX";
+    char journal_path[] = "/tmp/lob_journal_XXXXXX";
+    close(mkstemp(snapshot_path));
+    close(mkstemp(journal_path));
+    std::remove(snapshot_path);
+    std::remove(journal_path);
+    
+    // Snapshot half way through without truncating: recovery must skip the covered records
+    MatchingEngine live;
+    JournalConfig config;
+    config.group_commit_records = 64;
+    Journal journal;
+    assert(journal.open(journal_path, DEFAULT_TICK_SIZE, config));
+    std::mt19937 gen(21);
+    for (uint64_t seq = 1; seq <= 2000; ++seq) {
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        Command command = Command::add(seq, Order::limit_order(seq, 9990 + gen() % 21, 1 + gen() % 100, side));
+        if (seq % 6 == 0) {
+            command = Command::cancel(seq, seq - 5);
+        } else if (seq % 9 == 0) {
+            command = Command::modify(seq, seq - 4, 1 + gen() % 100);
+        }
+        assert(journal.append(command));
+        live.execute(command, [](const Fill&) {});
+        if (seq == 1200) {
+            assert(save_snapshot(live, seq, snapshot_path));
+        }
+    }
+    assert(journal.commits() < journal.appended() / 32);
+    assert(journal.close());
+    
+    MatchingEngine recovered;
+    RecoveryStats stats;
+    assert(recover_engine(snapshot_path, journal_path, recovered, stats));
+    assert(stats.snapshot_sequence == 1200 && stats.journal_records == 2000 && stats.replayed == 800);
+    assert(stats.last_sequence == 2000);
+    assert(same_engine_state(live, recovered));
+    
+    // Truncating after a snapshot leaves the journal reopenable and empty
+    assert(save_snapshot(live, 2000, snapshot_path));
+    assert(journal.open(journal_path, DEFAULT_TICK_SIZE, config) && journal.truncate());
+    assert(journal.append(Command::cancel(2001, 1999)));
+    assert(journal.close());
+    MatchingEngine restarted;
+    assert(recover_engine(snapshot_path, journal_path, restarted, stats));
+    assert(stats.journal_records == 1 && stats.replayed == 1);
+    assert(!journal.open(journal_path, 0.5));
+    
+    // A lone record is committed by the flusher once it reaches the age limit
+    config.group_commit_interval = std::chrono::microseconds(1000);
+    assert(journal.open(journal_path, DEFAULT_TICK_SIZE, config));
+    assert(journal.append(Command::cancel(2002, 1998)));
+    assert(journal.pending() == 1);
+    for (int i = 0; i < 1000 && journal.pending() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(journal.pending() == 0 && journal.commits() == 1);
+    assert(journal.close());
+    config.group_commit_interval = JournalConfig().group_commit_interval;
+    
+    // A write cut short by the file size limit resumes where it stopped, so
+    // no record reaches the file twice
+    std::remove(journal_path);
+    config.group_commit_interval = std::chrono::seconds(60);
+    assert(journal.open(journal_path, DEFAULT_TICK_SIZE, config));
+    for (uint64_t seq = 1; seq <= 5; ++seq) {
+        assert(journal.append(Command::cancel(seq, seq)));
+    }
+    std::signal(SIGXFSZ, SIG_IGN);
+    rlimit saved_limit;
+    getrlimit(RLIMIT_FSIZE, &saved_limit);
+    rlimit limit = saved_limit;
+    limit.rlim_cur = sizeof(FlowFileHeader) + 2 * sizeof(Command) + 20;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    assert(!journal.commit() && journal.pending() == 5);
+    setrlimit(RLIMIT_FSIZE, &saved_limit);
+    std::signal(SIGXFSZ, SIG_DFL);
+    assert(journal.commit() && journal.pending() == 0);
+    assert(journal.close());
+    std::FILE* written = std::fopen(journal_path, "rb");
+    std::fseek(written, sizeof(FlowFileHeader), SEEK_SET);
+    Command record;
+    uint64_t next_sequence = 1;
+    while (std::fread(&record, sizeof(record), 1, written) == 1) {
+        assert(record.sequence == next_sequence++);
+    }
+    assert(next_sequence == 6 && std::ftell(written) == static_cast<long>(sizeof(FlowFileHeader) + 5 * sizeof(Command)));
+    std::fclose(written);
+    config.group_commit_interval = JournalConfig().group_commit_interval;
+    
+    // The simulator journals what it applies, snapshots on its interval and
+    // comes back with the same book and fresh order ids after a restart
+    std::remove(snapshot_path);
+    std::remove(journal_path);
+    std::streambuf* saved_input = std::cin.rdbuf();
+    std::streambuf* saved_output = std::cout.rdbuf();
+    std::ostringstream discard;
+    std::cout.rdbuf(discard.rdbuf());
+    MatchingEngine session_book;
+    {
+        ExchangeSimulator first;
+        RecoveryStats session;
+        assert(first.open_journal(journal_path, snapshot_path, 3, session) && session.last_sequence == 0);
+        std::istringstream input("ADD BUY LIMIT 100 10\nADD SELL LIMIT 101 5\nADD BUY LIMIT 0 5\n"
+                                 "ADD BUY LIMIT 99 7\nMODIFY 3 4\nCANCEL 1\nADD SELL LIMIT 102 8\nQUIT\n");
+        std::cin.rdbuf(input.rdbuf());
+        first.run_interactive_mode();
+        session_book.get_order_book().add_order(*first.get_engine().get_order_book().find_order(2));
+        session_book.get_order_book().add_order(*first.get_engine().get_order_book().find_order(3));
+        session_book.get_order_book().add_order(*first.get_engine().get_order_book().find_order(4));
+    }
+    {
+        ExchangeSimulator second;
+        RecoveryStats session;
+        assert(second.open_journal(journal_path, snapshot_path, 3, session));
+        assert(session.snapshot_sequence == 3 && session.replayed == 3 && session.last_sequence == 6);
+        const OrderBook& book = second.get_engine().get_order_book();
+        assert(book.total_orders() == 3 && !book.has_order(1) && book.find_order(3)->quantity == 4);
+        assert(book.total_quantity() == session_book.get_order_book().total_quantity());
+        
+        std::istringstream input("ADD BUY LIMIT 98 1\nQUIT\n");
+        std::cin.rdbuf(input.rdbuf());
+        second.run_interactive_mode();
+        assert(book.has_order(7) && book.total_orders() == 4);
+    }
+    std::cin.rdbuf(saved_input);
+    std::cout.rdbuf(saved_output);
+    
+    // 1M resting orders: load the snapshot, replay a short tail
+    const size_t order_count = 1000000;
+    MatchingEngine large(nullptr, DEFAULT_TICK_SIZE, order_count + 16);
+    for (uint64_t id = 1; id <= order_count; ++id) {
+        Side side = id % 2 ? Side::BUY : Side::SELL;
+        Price price = side == Side::BUY ? 99999 - static_cast<Price>(id % 1000) : 100001 + static_cast<Price>(id % 1000);
+        large.get_order_book().add_order(Order::limit_order(id, price, 100, side));
+    }
+    assert(save_snapshot(large, order_count, snapshot_path));
+    config.sync = false;
+    assert(journal.open(journal_path, DEFAULT_TICK_SIZE, config) && journal.truncate());
+    for (uint64_t seq = order_count + 1; seq <= order_count + 10000; ++seq) {
+        Command command = Command::cancel(seq, seq - order_count);
+        assert(journal.append(command));
+        large.execute(command, [](const Fill&) {});
+    }
+    assert(journal.close());
+    
+    MatchingEngine restored(nullptr, DEFAULT_TICK_SIZE, order_count + 16);
+    assert(recover_engine(snapshot_path, journal_path, restored, stats));
+    assert(stats.snapshot_orders == order_count && stats.replayed == 10000);
+    assert(restored.get_order_book().total_orders() == order_count - 10000);
+    assert(same_engine_state(large, restored));
+    
+    std::remove(snapshot_path);
+    std::remove(journal_path);
+    std::cout << " PASSED (1M-order snapshot " << static_cast<int>(stats.snapshot_seconds * 1000)
+              << " ms, 10k-command tail " << static_cast<int>(stats.replay_seconds * 1000) << " ms)\n";
+}
+
+void test_process_batch() {
+    std::cout << "Testing batch processing...";
+    
+    // Random adds, cancels and modifies: batches must match one call per command
+    std::mt19937 gen(17);
+    std::vector<Command> commands;
+    for (uint64_t seq = 1; seq <= 3000; ++seq) {
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        if (seq % 8 == 0) {
+            commands.push_back(Command::cancel(seq, seq - 5));
+        } else if (seq % 11 == 0) {
+            commands.push_back(Command::modify(seq, seq - 3, 1 + gen() % 50));
+        } else if (seq % 13 == 0) {
+            commands.push_back(Command::add(seq, Order::market_order(seq, 1 + gen() % 300, side)));
+        } else {
+            commands.push_back(Command::add(seq, Order::limit_order(seq, 9990 + gen() % 21, 1 + gen() % 100, side)));
+        }
+    }
+    commands.push_back(Command::add(3001, Order::limit_order(3001, 10000, 0, Side::BUY)));
+    
+    MatchingEngine single;
+    std::vector<Fill> single_fills;
+    for (const Command& command : commands) {
+        single.execute(command, [&single_fills](const Fill& fill) { single_fills.push_back(fill); });
+    }
+    
+    for (size_t batch : {size_t(1), size_t(16), size_t(256)}) {
+        MatchingEngine batched;
+        std::vector<Fill> fills;
+        size_t reported = 0;
+        for (size_t i = 0; i < commands.size(); i += batch) {
+            reported += batched.process_batch(commands.data() + i, std::min(batch, commands.size() - i), fills);
+        }
+        assert(reported == single_fills.size() && fills.size() == single_fills.size());
+        for (size_t i = 0; i < fills.size(); ++i) {
+            assert(fills[i].buy_order_id == single_fills[i].buy_order_id);
+            assert(fills[i].sell_order_id == single_fills[i].sell_order_id);
+            assert(fills[i].price == single_fills[i].price && fills[i].quantity == single_fills[i].quantity);
+        }
+        assert(batched.total_fills() == single.total_fills());
+        assert(batched.total_volume() == single.total_volume());
+        assert(same_engine_state(batched, single));
+    }
+    assert(single.process_batch(commands.data(), 0, single_fills) == 0);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_call_auction() {
+    std::cout << "Testing call auction...";
+    
+    // Crossing orders rest; 1006-1008 all trade 350 with a buy surplus, so the highest wins
+    MatchingEngine engine;
+    engine.begin_auction();
+    engine.process_order(Order::limit_order(1, 1010, 300, Side::BUY));
+    engine.process_order(Order::limit_order(2, 1008, 200, Side::BUY));
+    engine.process_order(Order::limit_order(3, 1005, 100, Side::BUY));
+    engine.process_order(Order::limit_order(4, 1003, 100, Side::SELL));
+    engine.process_order(Order::limit_order(5, 1006, 250, Side::SELL));
+    engine.process_order(Order::limit_order(6, 1009, 300, Side::SELL));
+    assert(engine.process_order(Order::market_order(7, 50, Side::BUY)).empty());
+    assert(engine.get_order_book().total_orders() == 6 && engine.total_fills() == 0);
+    
+    AuctionResult indicative = engine.indicative_auction();
+    assert(indicative.crossed && indicative.price == 1008);
+    assert(indicative.volume == 350 && indicative.imbalance == 150);
+    
+    std::vector<Fill> fills;
+    AuctionResult result = engine.uncross([&fills](const Fill& fill) { fills.push_back(fill); });
+    assert(!engine.in_auction() && result.fills == 3 && fills.size() == 3);
+    assert(fills[0].buy_order_id == 1 && fills[0].sell_order_id == 4 && fills[0].quantity == 100);
+    assert(fills[2].buy_order_id == 2 && fills[2].sell_order_id == 5 && fills[2].quantity == 50);
+    for (const Fill& fill : fills) {
+        assert(fill.price == 10.08);
+    }
+    const OrderBook& book = engine.get_order_book();
+    assert(book.best_price(true) == 1008 && book.best_price(false) == 1009);
+    assert(engine.process_order(Order::limit_order(8, 1009, 10, Side::BUY)).size() == 1);
+    
+    // No surplus either way: the middle of the candidates, or the one nearest the reference
+    MatchingEngine balanced;
+    balanced.begin_auction();
+    balanced.process_order(Order::limit_order(1, 1002, 100, Side::BUY));
+    balanced.process_order(Order::limit_order(2, 998, 100, Side::SELL));
+    assert(balanced.indicative_auction().price == 1000);
+    assert(balanced.indicative_auction(1001).price == 1001);
+    assert(balanced.indicative_auction(5000).price == 1002);
+    balanced.process_order(Order::limit_order(3, 998, 40, Side::SELL));
+    assert(balanced.indicative_auction().price == 998);
+    assert(!MatchingEngine().indicative_auction().crossed);
+    
+    // As commands, execute and process_batch agree: 300 uncrosses at 1006 in two
+    // fills, then continuous matching resumes
+    std::vector<Command> session = {
+        Command::begin_auction(1),
+        Command::add(2, Order::limit_order(1, 1010, 300, Side::BUY)),
+        Command::add(3, Order::limit_order(2, 1003, 100, Side::SELL)),
+        Command::add(4, Order::limit_order(3, 1006, 250, Side::SELL)),
+        Command::uncross(5),
+        Command::add(6, Order::limit_order(4, 1006, 20, Side::BUY)),
+    };
+    MatchingEngine stepped;
+    MatchingEngine batched;
+    size_t stepped_fills = 0;
+    for (const Command& command : session) {
+        stepped_fills += stepped.execute(command, [](const Fill&) {});
+    }
+    assert(stepped_fills == 3 && stepped.total_fills() == 3 && stepped.last_trade_price() == 1006);
+    assert(batched.process_batch(session.data(), session.size(), [](const Fill&) {}) == 3);
+    assert(!batched.in_auction() && same_engine_state(stepped, batched));
+    Command parsed;
+    assert(parse_command("AUCTION", 7, DEFAULT_TICK_SIZE, parsed) && parsed.type == CommandType::BEGIN_AUCTION);
+    assert(parse_command("UNCROSS", 7, DEFAULT_TICK_SIZE, parsed) && parsed.type == CommandType::UNCROSS);
+    
+    // A snapshot taken mid-auction comes back in the auction with its crossed book
+    char auction_path[] = "/tmp/lob_auction_XXXXXX";
+    close(mkstemp(auction_path));
+    MatchingEngine crossed;
+    for (size_t i = 0; i < 4; ++i) {
+        crossed.execute(session[i], [](const Fill&) {});
+    }
+    assert(save_snapshot(crossed, 4, auction_path));
+    MatchingEngine reloaded;
+    uint64_t last_sequence = 0;
+    assert(load_snapshot(auction_path, reloaded, last_sequence) && last_sequence == 4);
+    assert(reloaded.in_auction() && reloaded.get_order_book().best_price(true) == 1010);
+    assert(reloaded.execute(session[4], [](const Fill&) {}) == 2);
+    std::remove(auction_path);
+    
+    // Random books: the linear pass finds the brute-force maximum and leaves the book uncrossed
+    std::mt19937 gen(23);
+    for (int round = 0; round < 20; ++round) {
+        MatchingEngine random;
+        random.begin_auction();
+        for (uint64_t id = 1; id <= 400; ++id) {
+            Side side = gen() % 2 ? Side::BUY : Side::SELL;
+            random.process_order(Order::limit_order(id, 980 + gen() % 41, 1 + gen() % 100, side));
+        }
+        int64_t best = 0;
+        for (Price price = 980; price <= 1020; ++price) {
+            int64_t buy = 0;
+            int64_t sell = 0;
+            for (Price p = price; p <= 1020; ++p) buy += random.get_order_book().level_quantity(true, p);
+            for (Price p = 980; p <= price; ++p) sell += random.get_order_book().level_quantity(false, p);
+            best = std::max(best, std::min(buy, sell));
+        }
+        AuctionResult uncrossed = random.uncross([](const Fill&) {});
+        assert(uncrossed.volume == best);
+        const OrderBook& after = random.get_order_book();
+        assert(!after.has_orders(true) || !after.has_orders(false) ||
+               after.best_price(true) < after.best_price(false));
+    }
+    
+    // A sparse cross 200,000 ticks wide: the candidates are whole runs of
+    // ticks between levels, and a balanced run still resolves to one tick
+    MatchingEngine sparse;
+    sparse.begin_auction();
+    sparse.process_order(Order::limit_order(1, 100000, 100, Side::SELL));
+    sparse.process_order(Order::limit_order(2, 250000, 50, Side::SELL));
+    sparse.process_order(Order::limit_order(3, 300000, 120, Side::BUY));
+    sparse.process_order(Order::limit_order(4, 200000, 30, Side::BUY));
+    AuctionResult sparse_result = sparse.indicative_auction();
+    assert(sparse_result.price == 250000 && sparse_result.volume == 120 && sparse_result.imbalance == -30);
+    MatchingEngine wide;
+    wide.begin_auction();
+    wide.process_order(Order::limit_order(1, 100000, 100, Side::SELL));
+    wide.process_order(Order::limit_order(2, 300000, 100, Side::BUY));
+    assert(wide.indicative_auction().price == 200000 && wide.indicative_auction(123456).price == 123456);
+    assert(wide.indicative_auction(5).price == 100000 && wide.indicative_auction().volume == 100);
+    
+    // 1M resting orders crossing over 2000 ticks
+    const uint64_t order_count = 1000000;
+    MatchingEngine large(nullptr, DEFAULT_TICK_SIZE, order_count + 16);
+    large.begin_auction();
+    for (uint64_t id = 1; id <= order_count; ++id) {
+        Side side = id % 2 ? Side::BUY : Side::SELL;
+        large.process_order(Order::limit_order(id, 99000 + static_cast<Price>(gen() % 2000), 1 + gen() % 100, side));
+    }
+    size_t large_fills = 0;
+    AuctionResult large_result = large.uncross([&large_fills](const Fill&) { large_fills++; });
+    assert(large_result.crossed && large_result.fills == large_fills && large_fills > 0);
+    assert(large.get_order_book().best_price(true) < large.get_order_book().best_price(false));
+    
+    std::cout << " PASSED\n";
+}
+
+void test_stage_timing() {
+    std::cout << "Testing stage timing...";
+    
+    MatchingEngine engine;
+    engine.process_order(Order::limit_order(1, 10000, 100, Side::SELL));
+    engine.process_order(Order::limit_order(2, 10001, 100, Side::SELL));
+    engine.process_order(Order::limit_order(3, 10001, 150, Side::BUY));
+    engine.process_order(Order::limit_order(4, 9990, 0, Side::BUY));
+    engine.cancel_order(2);
+    engine.cancel_order(99);
+    engine.modify_order(1, 10);
+
+#if LOB_STAGE_TIMING
+    // Every stage hit is counted once; invalid orders stop after validation
+    const StageStats& stats = engine.stage_stats();
+    assert(stats.histogram(Stage::VALIDATE).count() == 4);
+    assert(stats.histogram(Stage::MATCH).count() == 3);
+    assert(stats.histogram(Stage::INSERT).count() == 2);
+    assert(stats.histogram(Stage::NOTIFY).count() == 2);
+    assert(stats.histogram(Stage::CANCEL).count() == 2);
+    assert(stats.histogram(Stage::MODIFY).count() == 1);
+    assert(stats.histogram(Stage::MATCH).max() >= stats.histogram(Stage::NOTIFY).min());
+    
+    std::ostringstream json;
+    stats.write_json(json);
+    assert(json.str().find("\"notify\": {\"count\": 2") != std::string::npos);
+    engine.reset_stage_stats();
+    assert(engine.stage_stats().histogram(Stage::VALIDATE).count() == 0);
+    std::cout << " PASSED\n";
+#else
+    std::cout << " PASSED (compiled out)\n";
+#endif
+}
+
+void test_time_in_force() {
+    std::cout << "Testing IOC and FOK orders...";
+    
+    // Asks: 100 @ 1000, 200 @ 1001, 300 @ 1003
+    MatchingEngine engine;
+    engine.process_order(Order::limit_order(1, 1000, 100, Side::SELL));
+    engine.process_order(Order::limit_order(2, 1001, 200, Side::SELL));
+    engine.process_order(Order::limit_order(3, 1003, 300, Side::SELL));
+    const OrderBook& book = engine.get_order_book();
+    assert(book.available_quantity(false, 1001, 600) == 300);
+    assert(book.available_quantity(false, 1003, 250) == 300);
+    assert(book.available_quantity(false, 999, 1) == 0);
+    assert(book.available_quantity(false, 2000, 601) == 600);
+    
+    // IOC fills what it can inside its limit and never rests
+    Order ioc = Order::limit_order(10, 1001, 250, Side::BUY);
+    ioc.time_in_force = TimeInForce::IOC;
+    auto ioc_fills = engine.process_order(ioc);
+    assert(ioc_fills.size() == 2 && ioc_fills[1].quantity == 150);
+    assert(!book.has_orders(true) && book.side_quantity(false) == 350);
+    
+    // FOK short inside its limit is killed with the book untouched
+    uint64_t sequence = book.update_sequence();
+    Order fok = Order::limit_order(11, 1001, 51, Side::BUY);
+    fok.time_in_force = TimeInForce::FOK;
+    assert(engine.process_order(fok).empty());
+    assert(book.update_sequence() == sequence && book.side_quantity(false) == 350);
+    assert(engine.total_fills() == 2);
+    
+    // ... and fills completely once the limit covers enough
+    fok.order_id = 12;
+    fok.price = 1003;
+    fok.quantity = 200;
+    auto fok_fills = engine.process_order(fok);
+    assert(fok_fills.size() == 2 && fok_fills[0].quantity == 50 && fok_fills[1].quantity == 150);
+    assert(!book.has_orders(true) && book.side_quantity(false) == 150);
+    
+    // Market FOK against the whole side
+    Order market = Order::market_order(13, 151, Side::BUY);
+    market.time_in_force = TimeInForce::FOK;
+    assert(engine.process_order(market).empty());
+    market.quantity = 150;
+    assert(engine.process_order(market).size() == 1 && book.empty());
+    
+    // Neither may rest during an auction
+    MatchingEngine auction;
+    auction.begin_auction();
+    Order resting = Order::limit_order(1, 1000, 10, Side::BUY);
+    resting.time_in_force = TimeInForce::IOC;
+    auction.process_order(resting);
+    assert(auction.get_order_book().empty());
+    
+    // Text forms
+    Command command;
+    const char* text = "ADD BUY LIMIT 10.00 5 FOK";
+    assert(parse_command(text, std::strlen(text), DEFAULT_TICK_SIZE, command));
+    assert(command.order.time_in_force == TimeInForce::FOK);
+    assert(time_in_force_from_string("IOC") == TimeInForce::IOC);
+    assert(Order::create_limit_order(1, 10.0, 5, "BUY").time_in_force == TimeInForce::GTC);
+    try {
+        time_in_force_from_string("DAY");
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+    
+    std::cout << " PASSED\n";
+}
+
+void test_stop_orders() {
+    std::cout << "Testing stop orders...";
+    
+    MatchingEngine engine;
+    engine.process_order(Order::limit_order(1, 1000, 100, Side::SELL));
+    engine.process_order(Order::limit_order(2, 1001, 100, Side::SELL));
+    engine.process_order(Order::limit_order(3, 1002, 100, Side::SELL));
+    engine.process_order(Order::limit_order(4, 990, 100, Side::BUY));
+    
+    // Nothing has traded yet, so nothing fires on arrival
+    std::vector<Fill> fills;
+    assert(engine.submit_stop(Order::market_order(10, 100, Side::BUY), 1001, fills) == 0);
+    assert(engine.submit_stop(Order::limit_order(11, 1002, 150, Side::BUY), 1000, fills) == 0);
+    assert(engine.submit_stop(Order::market_order(12, 10, Side::SELL), 995, fills) == 0);
+    assert(engine.submit_stop(Order::market_order(12, 10, Side::SELL), 995, fills) == 0);
+    assert(engine.submit_stop(Order::market_order(1, 10, Side::SELL), 995, fills) == 0);    // id 1 is resting
+    const StopBook& stops = engine.get_stop_book();
+    assert(!stops.contains(1));
+    assert(stops.size() == 3 && stops.side_size(true) == 2 && engine.get_order_book().total_orders() == 4);
+    
+    // ...and the other way round: an add reusing a pending stop's id never rests,
+    // so cancelling that id still withdraws the stop
+    assert(engine.process_order(Order::limit_order(12, 980, 5, Side::BUY)).empty());
+    assert(!engine.get_order_book().has_order(12) && !engine.modify_order(12, 20, 985));
+    assert(stops.size() == 3 && stops.contains(12) && engine.get_order_book().total_orders() == 4);
+    
+    // A trade at 1000 fires the stop-limit, whose fill at 1001 fires the stop
+    fills = engine.process_order(Order::market_order(20, 50, Side::BUY));
+    assert(fills.size() == 4 && engine.last_trade_price() == 1002);
+    assert(fills[1].buy_order_id == 11 && fills[1].quantity == 50);
+    assert(fills[2].buy_order_id == 11 && fills[2].price == 10.01);
+    assert(fills[3].buy_order_id == 10 && fills[3].sell_order_id == 3);
+    assert(stops.size() == 1 && !engine.get_order_book().has_orders(false));
+    
+    // Stops cancel like resting orders
+    assert(engine.cancel_order(12) && !engine.cancel_order(12) && stops.empty());
+    
+    // A trigger the last price already reached fires on arrival
+    fills.clear();
+    assert(engine.submit_stop(Order::market_order(30, 40, Side::SELL), 1500, fills) == 1);
+    assert(fills[0].buy_order_id == 4 && engine.last_trade_price() == 990);
+    
+    // Batches and the snapshot keep stops exactly as single commands would
+    std::mt19937 gen(31);
+    std::vector<Command> commands;
+    for (uint64_t seq = 1; seq <= 3000; ++seq) {
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        Price price = 990 + gen() % 21;
+        if (seq % 5 == 0) {
+            Price trigger = side == Side::BUY ? price + 3 : price - 3;
+            commands.push_back(Command::add_stop(seq, Order::market_order(seq, 1 + gen() % 50, side), trigger));
+        } else if (seq % 17 == 0) {
+            commands.push_back(Command::cancel(seq, seq - 10));
+        } else {
+            commands.push_back(Command::add(seq, Order::limit_order(seq, price, 1 + gen() % 100, side)));
+        }
+    }
+    MatchingEngine single;
+    size_t single_fills = 0;
+    for (const Command& command : commands) {
+        single_fills += single.execute(command, [](const Fill&) {});
+    }
+    MatchingEngine batched;
+    assert(batched.process_batch(commands.data(), commands.size(), [](const Fill&) {}) == single_fills);
+    assert(same_engine_state(single, batched) && single.get_stop_book().size() == batched.get_stop_book().size());
+    assert(single.last_trade_price() == batched.last_trade_price());
+    
+    char snapshot_path[] = "/tmp/lob_stops_XXXXXX";
+    close(mkstemp(snapshot_path));
+    assert(save_snapshot(single, 3000, snapshot_path));
+    MatchingEngine restored;
+    uint64_t last_sequence = 0;
+    assert(load_snapshot(snapshot_path, restored, last_sequence) && last_sequence == 3000);
+    assert(restored.get_stop_book().size() == single.get_stop_book().size());
+    assert(restored.last_trade_price() == single.last_trade_price());
+    std::remove(snapshot_path);
+    
+    // 100k pending stops: each trade fires only the ones it crossed
+    MatchingEngine deep(nullptr, DEFAULT_TICK_SIZE, 1024);
+    for (uint64_t id = 1; id <= 100000; ++id) {
+        deep.submit_stop(Order::market_order(id, 1, Side::BUY), 2000 + static_cast<Price>(id % 1000), fills);
+    }
+    deep.process_order(Order::limit_order(200001, 2004, 1000, Side::SELL));
+    fills = deep.process_order(Order::limit_order(200002, 2004, 1, Side::BUY));
+    assert(fills.size() == 1 + 500 && deep.get_stop_book().size() == 100000 - 500);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_order_index() {
+    std::cout << "Testing order index...";
+    
+    // Random churn against a reference map, in a table small enough to wrap and shift a lot
+    OrderIndex<int> index(8);
+    std::unordered_map<uint64_t, int*> reference;
+    std::vector<int> values(4096);
+    std::mt19937_64 gen(37);
+    for (int step = 0; step < 200000; ++step) {
+        uint64_t key = gen() % 2048;
+        if (gen() % 3) {
+            int* value = &values[key];
+            assert(index.insert(key, value) == reference.emplace(key, value).second);
+        } else {
+            int* expected = reference.count(key) ? reference[key] : nullptr;
+            assert(index.erase(key) == expected);
+            reference.erase(key);
+        }
+        assert(index.size() == reference.size());
+    }
+    for (uint64_t key = 0; key < 2048; ++key) {
+        assert(index.find(key) == (reference.count(key) ? reference[key] : nullptr));
+    }
+    OrderIndexStats stats = index.stats();
+    assert(stats.entries == reference.size() && stats.load_factor <= 0.5);
+    assert(stats.mean_probe >= 1.0 && stats.max_probe >= 1 && stats.bytes == index.memory_bytes());
+    
+    // Filled orders leave the index, so cancels of them fail and nothing piles up
+    MatchingEngine engine;
+    const OrderBook& book = engine.get_order_book();
+    for (uint64_t id = 1; id <= 10000; ++id) {
+        engine.process_order(Order::limit_order(id, 1000, 10, id % 2 ? Side::BUY : Side::SELL));
+    }
+    assert(book.empty() && book.index_stats().entries == 0);
+    assert(!book.has_order(9999) && !engine.cancel_order(9999));
+    engine.process_order(Order::limit_order(10001, 1000, 10, Side::SELL));
+    engine.process_order(Order::limit_order(10002, 1000, 4, Side::BUY));
+    assert(book.has_order(10001) && !book.has_order(10002));
+    assert(book.memory_stats().index_capacity >= OrderBook::DEFAULT_ORDER_CAPACITY);
+    
+    std::cout << " PASSED\n";
+}
+
+void test_amend_priority() {
+    std::cout << "Testing amend priority...";
+    
+    MatchingEngine engine;
+    const OrderBook& book = engine.get_order_book();
+    engine.process_order(Order::limit_order(1, 10000, 10, Side::BUY));
+    engine.process_order(Order::limit_order(2, 10000, 20, Side::BUY));
+    engine.process_order(Order::limit_order(3, 10000, 30, Side::BUY));
+    
+    // A reduction keeps its place, an increase goes to the back of the queue
+    assert(engine.modify_order(2, 5));
+    assert(engine.modify_order(1, 15));
+    assert(book.level_quantity(true, 10000) == 50 && book.side_quantity(true) == 50);
+    assert(book.find_order(1)->quantity == 15 && book.find_order(2)->quantity == 5);
+    assert(!engine.modify_order(2, 0) && !engine.modify_order(99, 5));
+    assert(!engine.get_order_book().reduce_order(2, 6) && book.level_quantity(true, 10000) == 50);
+    auto fills = engine.process_order(Order::market_order(4, 50, Side::SELL));
+    assert(fills.size() == 3);
+    assert(fills[0].buy_order_id == 2 && fills[1].buy_order_id == 3 && fills[2].buy_order_id == 1);
+    
+    // A price change moves the order between levels and trades if it now crosses
+    engine.process_order(Order::limit_order(5, 10100, 40, Side::SELL));
+    engine.process_order(Order::limit_order(6, 9900, 25, Side::BUY));
+    assert(engine.modify_order(6, 25, 9950));
+    assert(book.level_quantity(true, 9900) == 0 && book.level_quantity(true, 9950) == 25);
+    
+    // A replacement that could not rest is refused and the original stays put
+    assert(!engine.modify_order(6, 10, 1000000000));
+    assert(book.has_order(6) && book.find_order(6)->quantity == 25 && book.level_quantity(true, 9950) == 25);
+    std::vector<Fill> amend_fills;
+    assert(engine.modify_order(6, 30, 10100, amend_fills));
+    assert(amend_fills.size() == 1 && amend_fills[0].quantity == 30 && amend_fills[0].sell_order_id == 5);
+    assert(!book.has_order(6) && book.level_quantity(false, 10100) == 10 && !book.has_orders(true));
+    assert(engine.total_fills() == 4 && engine.last_trade_price() == 10100);
+    
+    // The same amendment through the command path reports its fills
+    std::vector<Fill> command_fills;
+    engine.process_order(Order::limit_order(7, 10000, 10, Side::BUY));
+    assert(engine.execute(Command::replace(1, 7, 10, 10100), command_fills) == 1);
+    assert(book.empty());
+    
+    std::cout << " PASSED\n";
+}
+
+void test_mass_cancel() {
+    std::cout << "Testing mass cancel...";
+    
+    // Twin engines on the same random flow: bulk cancels on one, the same orders
+    // cancelled one by one on the other, must leave identical books
+    MatchingEngine bulk;
+    MatchingEngine single;
+    std::mt19937 gen(53);
+    std::vector<Order> orders;
+    for (uint64_t id = 1; id <= 3000; ++id) {
+        Side side = gen() % 2 ? Side::BUY : Side::SELL;
+        Order order = Order::limit_order(id, side == Side::BUY ? 9950 + gen() % 50 : 10001 + gen() % 50,
+                                         1 + gen() % 100, side);
+        order.owner_id = static_cast<uint16_t>(gen() % 4);
+        bulk.process_order(order);
+        single.process_order(order);
+        orders.push_back(order);
+    }
+    const OrderBook& book = bulk.get_order_book();
+    std::vector<LevelUpdate> updates;
+    bulk.get_order_book().set_level_listener([&updates](const LevelUpdate& update) { updates.push_back(update); });
+    
+    auto cancel_matching = [&](const MassCancel& filter) {
+        size_t expected = 0;
+        for (const Order& order : orders) {
+            if (filter.matches(order) && single.cancel_order(order.order_id)) {
+                expected++;
+            }
+        }
+        return expected;
+    };
+    auto same_books = [&] {
+        for (bool buy_side : {true, false}) {
+            auto a = buy_side ? book.get_bid_levels(1000) : book.get_ask_levels(1000);
+            auto b = buy_side ? single.get_order_book().get_bid_levels(1000) : single.get_order_book().get_ask_levels(1000);
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (a[i].price != b[i].price || a[i].total_quantity != b[i].total_quantity ||
+                    a[i].order_count != b[i].order_count) return false;
+            }
+            if (book.side_quantity(buy_side) != single.get_order_book().side_quantity(buy_side)) return false;
+        }
+        return book.total_orders() == single.get_order_book().total_orders() &&
+               book.index_stats().entries == book.total_orders();
+    };
+    
+    // A range at the touch moves the best bid; one level update per emptied level
+    MassCancel range = MassCancel::price_range(Side::BUY, 9990, 10000);
+    size_t levels_in_range = 0;
+    for (Price price = 9990; price <= 9999; ++price) {
+        levels_in_range += book.level_quantity(true, price) > 0;
+    }
+    assert(bulk.mass_cancel(range) == cancel_matching(range));
+    assert(updates.size() == levels_in_range && book.best_price(true) < 9990);
+    assert(same_books());
+    
+    // Owner and side cancels reach pending stops too, price ranges do not
+    Order stop = Order::market_order(5000, 10, Side::SELL);
+    stop.owner_id = 2;
+    std::vector<Fill> fills;
+    bulk.submit_stop(stop, 9000, fills);
+    MassCancel asks = MassCancel::price_range(Side::SELL, 1, 20000);
+    assert(bulk.mass_cancel(asks) == cancel_matching(asks));
+    assert(bulk.get_stop_book().size() == 1);
+    MassCancel owner = MassCancel::of_owner(2);
+    assert(bulk.mass_cancel(owner) == cancel_matching(owner) + 1 && bulk.get_stop_book().empty());
+    assert(same_books());
+    assert(bulk.mass_cancel(MassCancel::of_side(Side::BUY)) == cancel_matching(MassCancel::of_side(Side::BUY)));
+    assert(same_books() && book.empty() && !bulk.cancel_order(orders[0].order_id));
+    
+    // Everything, through the command path; the book stays usable afterwards
+    bulk.process_order(Order::limit_order(1, 10000, 10, Side::BUY));
+    bulk.process_order(Order::limit_order(2, 10001, 10, Side::SELL));
+    Command command;
+    assert(parse_command("MASSCANCEL", 10, DEFAULT_TICK_SIZE, command));
+    assert(command.type == CommandType::MASS_CANCEL && command.mass_cancel_filter().scope == MassCancelScope::ALL);
+    bulk.execute(command, fills);
+    assert(book.empty() && book.index_stats().entries == 0 && book.memory_stats().orders_in_use == 0);
+    assert(bulk.process_order(Order::limit_order(1, 10000, 10, Side::BUY)).empty() && book.has_order(1));
+    
+    assert(parse_command("MASSCANCEL BUY 99.90 100.00", 27, DEFAULT_TICK_SIZE, command));
+    MassCancel parsed = command.mass_cancel_filter();
+    assert(parsed.scope == MassCancelScope::PRICE_RANGE && parsed.low == 9990 && parsed.high == 10000);
+    assert(parse_command("MASSCANCEL OWNER 7", 18, DEFAULT_TICK_SIZE, command));
+    assert(command.mass_cancel_filter().owner_id == 7);
+    assert(!parse_command("MASSCANCEL BUY 100", 18, DEFAULT_TICK_SIZE, command));
+    
+    // Owner cancel on a sparse, wide ladder: both sides, the touch and the far
+    // ends, with the best levels emptied and re-found along the way
+    MatchingEngine sparse;
+    uint64_t sparse_id = 1;
+    for (Price offset = 0; offset < 200000; offset += 20000) {
+        for (uint16_t owner = 0; owner < 2; ++owner) {
+            Order bid = Order::limit_order(sparse_id++, 300000 - offset, 10, Side::BUY);
+            Order ask = Order::limit_order(sparse_id++, 300001 + offset, 10, Side::SELL);
+            bid.owner_id = ask.owner_id = static_cast<uint16_t>(offset % 40000 == 0 ? owner : 1);
+            sparse.process_order(bid);
+            sparse.process_order(ask);
+        }
+    }
+    const OrderBook& sparse_book = sparse.get_order_book();
+    assert(sparse_book.total_orders() == 40);
+    assert(sparse.mass_cancel(MassCancel::of_owner(0)) == 10);
+    assert(sparse_book.total_orders() == 30 && sparse_book.best_price(true) == 300000);
+    assert(sparse.mass_cancel(MassCancel::of_owner(1)) == 30 && sparse_book.empty());
+    
+    std::cout << " PASSED\n";
+}
+
+void test_monte_carlo() {
+    std::cout << "Testing Monte Carlo runner...";
+    
+    MonteCarloConfig config;
+    config.run_count = 24;
+    config.orders_per_run = 2000;
+    config.base_seed = 7;
+    config.flow.cancel_ratio = 0.1;
+    
+    // Work stealing must not leak into the results: any thread count gives
+    // the same paths in the same slots
+    config.thread_count = 1;
+    MonteCarloReport serial = MonteCarloRunner(config).run();
+    config.thread_count = 4;
+    MonteCarloReport parallel = MonteCarloRunner(config).run();
+    assert(serial.paths.size() == 24 && parallel.paths.size() == 24);
+    assert(parallel.thread_count == 4);
+    
+    auto same_path = [](const PathResult& a, const PathResult& b) {
+        return a.seed == b.seed && a.fills == b.fills && a.volume == b.volume && a.spread == b.spread &&
+               a.bid_depth == b.bid_depth && a.ask_depth == b.ask_depth && a.resting_orders == b.resting_orders;
+    };
+    for (size_t run = 0; run < serial.paths.size(); ++run) {
+        assert(same_path(serial.paths[run], parallel.paths[run]));
+        assert(serial.paths[run].seed == MonteCarloRunner::path_seed(7, run));
+        assert(serial.paths[run].fills > 0 && serial.paths[run].volume > 0);
+    }
+    assert(serial.fills.p50 == parallel.fills.p50 && serial.volume.mean == parallel.volume.mean);
+    assert(serial.spread.count + serial.one_sided_paths == 24);
+    
+    // A single seed replays one path of the batch exactly
+    PathResult replayed = MonteCarloRunner::run_path(serial.paths[13].seed, config.flow, config.orders_per_run);
+    assert(same_path(replayed, serial.paths[13]));
+    assert(MonteCarloRunner::path_seed(7, 0) != MonteCarloRunner::path_seed(7, 1));
+    assert(MonteCarloRunner::path_seed(7, 1) != MonteCarloRunner::path_seed(8, 0));
+    
+    // Nearest-rank percentiles over 1..100
+    std::vector<double> values;
+    for (int i = 100; i >= 1; --i) {
+        values.push_back(i);
+    }
+    Distribution dist = Distribution::of(values);
+    assert(dist.count == 100 && dist.min == 1 && dist.max == 100);
+    assert(dist.p5 == 5 && dist.p50 == 50 && dist.p95 == 95 && dist.mean == 50.5);
+    assert(Distribution::of({}).count == 0);
+    
+    std::cout << " PASSED\n";
+}
+
 int main() {
     std::cout << "Running Order Book Tests\n";
     std::cout << "========================\n\n";
     
     try {
-
+        
         test_order_creation();
         test_orderbook_basic();
         test_order_cancellation();
         test_matching_basic();
+        test_price_ladder();
+        test_matching_sweep();
+        test_cancel_preserves_fifo();
+        test_pooled_book_allocations();
+        test_fill_sinks();
+        test_map_book_parity();
+        test_level_aggregates();
+        test_async_logger();
+        test_headless_replay();
+        test_flow_record_replay();
+        test_sharded_exchange();
+        test_order_pipeline();
+        test_level_update_feed();
+        test_journal_recovery();
+        test_process_batch();
+        test_call_auction();
+        test_stage_timing();
+        test_time_in_force();
+        test_stop_orders();
+        test_order_index();
+        test_amend_priority();
+        test_mass_cancel();
+        test_monte_carlo();
         
         std::cout << "\nAll tests passed successfully!\n";
         return 0;
-        
+    
     } catch (const std::exception& e) {
         std::cout << "\nTest failed: " << e.what() << std::endl;
         return 1;